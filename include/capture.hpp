@@ -0,0 +1,38 @@
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+//===================================================================
+// capture.hpp
+// Definitions for the pin capture (logic analyzer) mode (see
+// capture.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+#define CAPTURE_RUNS_MAX          1024      // stored runs, 12 bytes each
+#define CAPTURE_SAMPLES_MAX       100000000 // pre or post samples
+#define CAPTURE_RATE_MAX          100000    // Hz
+
+// 'capture' subcommands, list order must match the enum
+#define CAPTURE_SUBCMD_KEYWORDS   "arm|rle|vcd"
+
+typedef enum {
+    CAPTURE_ARM = 0,
+    CAPTURE_RLE,
+    CAPTURE_VCD,
+
+} capture_subcmd_t;
+
+// 'capture arm' triggers, list order must match the enum
+#define CAPTURE_TRIGGER_KEYWORDS  "now|rise|fall|edge|pattern"
+
+typedef enum {
+    CAPTURE_TRIG_NOW = 0,
+    CAPTURE_TRIG_RISE,
+    CAPTURE_TRIG_FALL,
+    CAPTURE_TRIG_EDGE,
+    CAPTURE_TRIG_PATTERN,
+
+} capture_trigger_t;
+
+int captureCmd(int argCnt);
+
+#endif // _CAPTURE_H_
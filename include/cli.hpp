@@ -3,9 +3,7 @@
 
 #include <Arduino.h>
 #include "main.hpp"
-
-// update CLI_COMMAND_CNT if adding new commands to table in cli.cpp
-#define CLI_COMMAND_CNT           12
+#include "terminal.hpp"
 
 #define CMD_NAME_MAX              12
 
@@ -14,7 +12,68 @@
 #define CLI_ERR_CMD_NOT_FOUND     1
 #define CLI_ERR_TOO_FEW_ARGS      2
 #define CLI_ERR_TOO_MANY_ARGS     3
+#define CLI_ERR_AMBIGUOUS         4
+#define CLI_ERR_BAD_ARG           5
+#define CLI_ERR_EMPTY             6
 #define MAX_TOKENS                8
+#define MAX_ARGS                  (MAX_TOKENS - 1)
+#define CLI_RUN_DEPTH_MAX         4
+
+// argument types for command signatures
+typedef enum {
+    ARG_INT = 0,            // decimal, or hex with 0x prefix; .i
+    ARG_HEX,                // hex with or without 0x prefix; .u
+    ARG_FIXED,              // decimal w/up to 3 fraction digits; .i in thousandths
+    ARG_KEYWORD,            // one of a '|' separated list; .i is the list index
+    ARG_PIN,                // pin name or Arduino pin number; .i is the pin number
+    ARG_STRING,             // any token; .s points into the input line
+    ARG_REST,               // last spec only: this and all following tokens as ARG_STRING
+
+} cli_arg_type_t;
+
+// one argument of a command signature, min/max are inclusive and
+// only apply to numeric types
+typedef struct {
+    const char      *name;
+    cli_arg_type_t  type;
+    int32_t         min;
+    int32_t         max;
+    const char      *keywords;
+
+} cli_arg_spec_t;
+
+#define CLI_ARG_INT(name, min, max)     {name, ARG_INT, min, max, nullptr}
+#define CLI_ARG_HEX(name, min, max)     {name, ARG_HEX, (int32_t) (min), (int32_t) (max), nullptr}
+#define CLI_ARG_FIXED(name, min, max)   {name, ARG_FIXED, min, max, nullptr}
+#define CLI_ARG_KEYWORD(name, list)     {name, ARG_KEYWORD, 0, 0, list}
+#define CLI_ARG_PIN(name)               {name, ARG_PIN, 0, 0, nullptr}
+#define CLI_ARG_STRING(name)            {name, ARG_STRING, 0, 0, nullptr}
+#define CLI_ARG_REST(name)              {name, ARG_REST, 0, 0, nullptr}
+
+// parsed argument value, cliArgs[n] holds the n-th argument after
+// the command; present is false for omitted optional arguments
+typedef struct {
+    bool            present;
+    union {
+        int32_t     i;
+        uint32_t    u;
+        const char  *s;
+    };
+
+} cli_arg_t;
+
+extern cli_arg_t        cliArgs[MAX_ARGS];
+
+// longest 'repeat' interval, msecs
+#define REPEAT_INTERVAL_MAX       3600000UL
+
+// long running commands run as a job stepped from loop(), see
+// cliJobStart(); a step returns CLI_JOB_RUNNING until it is done,
+// then the command status.  With cancel true it must clean up and
+// return a status.
+#define CLI_JOB_RUNNING           (-2)
+
+typedef int (*cli_job_t)(bool cancel);
 
 void CURSOR(uint8_t r,uint8_t c);
 void terminalOut(char *msg);
@@ -23,6 +82,18 @@ void doPrompt(void);
 void doHello(void);
 int waitAnyKey(void);
 bool cli(char *raw);
+bool cliLine(const char *raw);
+int cliParsePin(const char *token);
+int cliLastStatus(void);
+int cliCompile(const char *cmdLine, uint8_t *code, int size);
+bool cliRunCode(const uint8_t *code, int len);
+uint32_t cliRegistryId(void);
+const char *cliCommandName(int index);
+int cliJobStart(cli_job_t job);
+bool cliJobDetached(void);
+bool cliJobActive(void);
+bool cliCommandRunning(void);
+bool cliJobService(void);
 int help(int);
 void showCommandHelp(char *cmd);
 
@@ -6,15 +6,72 @@
 //===================================================================
 #include <stdint-gcc.h>
 
+// 'power' command keywords, list order must match the enums
+#define PWR_ACTION_KEYWORDS       "up|down|status"
+#define PWR_TARGET_KEYWORDS       "main|aux|card"
+
+typedef enum {
+    PWR_UP = 0,
+    PWR_DOWN,
+    PWR_STATUS,
+
+} pwr_action_t;
+
+typedef enum {
+    PWR_MAIN = 0,
+    PWR_AUX,
+    PWR_CARD,
+
+} pwr_target_t;
+
+// 'set' command parameters, list order must match the enum
+#define SET_PARAM_KEYWORDS        "sdelay|pdelay"
+
+typedef enum {
+    SET_SDELAY = 0,
+    SET_PDELAY,
+
+} set_param_t;
+
+// 'snap' output formats, list order must match the enum
+#define SNAP_FORMAT_KEYWORDS      "csv|json|header"
+
+typedef enum {
+    SNAP_CSV = 0,
+    SNAP_JSON,
+    SNAP_HEADER,
+
+} snap_format_t;
+
+// output pins that change together, see writePinGroup()
+typedef enum {
+    PIN_GROUP_PWR_EN = 0,       // OCP_MAIN_PWR_EN, OCP_AUX_PWR_EN
+    PIN_GROUP_SCAN,             // OCP_SCAN_LD_N, OCP_SCAN_CLK
+    PIN_GROUP_CARD,             // power enables and PHY_RESET_N
+
+    PIN_GROUP_CNT,
+
+} pin_group_t;
+
 void monitorsInit(void);
 const char *getPinName(int pinNo);
-int8_t getPinIndex(uint8_t pinNo);
+int8_t getPinIndex(int pinNo);
+const pin_mgt_t *getPinByIndex(int index);
+uint32_t getPinPortMask(int index, uint8_t *port);
+int getPinByName(const char *name);
 int statusCmd(int arg);
 char *padBuffer(int pos);
 void configureIOPins(void);
 void readAllPins(void);
 bool readPin(uint8_t pinNo);
 void writePin(uint8_t pinNo, uint8_t value);
+uint32_t pinBit(int pinNo);
+uint32_t pinGroupBits(pin_group_t group);
+void writePinGroup(pin_group_t group, uint8_t value);
+bool writePinMask(uint32_t mask, uint32_t levels);
 bool isCardPresent(void);
+void get12VData(int32_t *v12I, int32_t *v12V);
+void get3P3VData(int32_t *v3p3I, int32_t *v3p3V);
+uint32_t queryScanChain(bool displayResults);
 
 #endif // _COMMANDS_H_
\ No newline at end of file
@@ -1,6 +1,26 @@
 #ifndef _DEBUG_H_
 #define _DEBUG_H_
 
+// 'xdebug' subcommands, list order must match the enum
+#define DEBUG_SUBCMD_KEYWORDS     "scan|reset|flash|perf|tasks"
+
+typedef enum {
+    DEBUG_SCAN = 0,
+    DEBUG_RESET,
+    DEBUG_FLASH,
+    DEBUG_PERF,
+    DEBUG_TASKS,
+
+} debug_subcmd_t;
+
+// optional second 'xdebug' argument, list order must match the enum
+#define DEBUG_OPTION_KEYWORDS     "reset"
+
+typedef enum {
+    DEBUG_OPT_RESET = 0,
+
+} debug_option_t;
+
 void debug_scan(void);
 void debug_reset(void);
 void debug_dump_eeprom(void);
@@ -9,6 +9,15 @@
 
 #define MAX_EEPROM_ADDR       (8 * 1024 - 1)
 
+// 'eeprom' subcommands, list order must match the enum
+#define EEPROM_SUBCMD_KEYWORDS    "show|dump"
+
+typedef enum {
+    EEPROM_SHOW = 0,
+    EEPROM_DUMP,
+
+} eeprom_subcmd_t;
+
 // EEPROM data storage struct
 typedef struct {
     uint32_t        sig;                  // unique EEPROMP signature (see #define)
@@ -67,6 +76,10 @@ void EEPROM_Save(void);
 void EEPROM_Read(void);
 void EEPROM_Defaults(void);
 bool EEPROM_InitLocal(void);
+void EEPROM_readBlock(uint16_t addr, void *dest, uint16_t len);
+void EEPROM_writeBlock(uint16_t addr, const void *src, uint16_t len);
+void EEPROM_commit(void);
+uint16_t EEPROM_length(void);
 void readEEPROM(uint8_t i2cAddr, uint32_t eeaddress, uint8_t *dest, uint16_t length);
 void writeEEPROMPage(uint8_t i2cAddr, long eeAddress, uint8_t *buffer);
 
@@ -0,0 +1,37 @@
+#ifndef _EVENTS_H_
+#define _EVENTS_H_
+//===================================================================
+// events.hpp
+// Definitions for the GPIO edge journal (see events.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+// journal size in records, must be a power of 2
+#define EVENTS_RING_SIZE          128
+
+// records shown per pass of 'events live'
+#define EVENTS_LIVE_BATCH         8
+
+// 'events' subcommands, list order must match the enum
+#define EVENTS_SUBCMD_KEYWORDS    "show|clear|live"
+
+typedef enum {
+    EVENTS_SHOW = 0,
+    EVENTS_CLEAR,
+    EVENTS_LIVE,
+
+} events_subcmd_t;
+
+// one edge, as seen by the EIC handler
+typedef struct {
+    uint32_t        us;                   // micros() at the interrupt
+    uint8_t         pinNo;
+    uint8_t         level;                // pin level after the edge
+
+} event_t;
+
+void events_Init(void);
+void events_record(uint8_t pinNo);
+int eventsCmd(int argCnt);
+
+#endif // _EVENTS_H_
@@ -0,0 +1,18 @@
+#ifndef _FMT_H_
+#define _FMT_H_
+//===================================================================
+// fmt.hpp
+// Integer and fixed point formatting (see fmt.cpp).  Used instead of
+// sprintf() on measurement paths so float printf isn't linked in.
+//===================================================================
+#include <stdint-gcc.h>
+
+extern const char fmt_hexDigits[];
+
+char *fmt_str(char *d, const char *s);
+char *fmt_u32(char *d, uint32_t v);
+char *fmt_i32(char *d, int32_t v);
+char *fmt_hex(char *d, uint32_t v, uint8_t digits);
+char *fmt_milli(char *d, int32_t milli, uint8_t decimals, uint8_t width);
+
+#endif // _FMT_H_
@@ -90,7 +90,9 @@ typedef struct {
 
 // misc functions
 void dumpMem(unsigned char *s, int len);
+void dumpMemAt(uint32_t addr, unsigned char *s, int len);
 const char *getPinName(int pinNo);
-int8_t getPinIndex(uint8_t pinNo);
+int8_t getPinIndex(int pinNo);
+void serviceBackground(void);
 
 #endif // _MAIN_H_
@@ -0,0 +1,36 @@
+#ifndef _PERF_H_
+#define _PERF_H_
+//===================================================================
+// perf.hpp
+// Definitions for latency instrumentation (see perf.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+// per-command stats slots, must cover every CLI command
+#define PERF_CMD_MAX              24
+
+// probe points in hot paths, list order must match perfProbeNames[]
+typedef enum {
+    PERF_EEPROM_READ = 0,
+    PERF_SCAN_CAPTURE,
+    PERF_INA219_READ,
+    PERF_USB_SEND,
+    PERF_PROBE_CNT,
+
+} perf_probe_t;
+
+typedef struct {
+    uint32_t        count;
+    uint32_t        minUs;
+    uint32_t        maxUs;
+    uint64_t        totalUs;
+    uint32_t        bytes;                // terminal output, commands only
+
+} perf_stat_t;
+
+void perf_cmdRecord(int cmd, uint32_t startUs, uint32_t bytes);
+void perf_probe(perf_probe_t probe, uint32_t startUs);
+void perf_reset(void);
+void perf_show(void);
+
+#endif // _PERF_H_
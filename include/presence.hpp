@@ -0,0 +1,28 @@
+#ifndef _PRESENCE_H_
+#define _PRESENCE_H_
+//===================================================================
+// presence.hpp
+// Definitions for NIC card presence tracking (see presence.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+#define PRESENCE_DEBOUNCE_MS      20        // PRSNTB quiet time before a change counts
+#define PRESENCE_TASK_MS          5         // debounce task period
+#define PRESENCE_BACKSTOP_MS      500       // resample without an edge this often
+
+#define PRSNTB_NONE               0xF       // PRSNTB[3:0] with no card
+
+// debounced card state, only changed by the presence task
+typedef struct {
+    bool            present;
+    uint8_t         prsntb;               // PRSNTB[3:0] levels
+    uint32_t        insertedMs;           // millis() at the last insertion
+    uint32_t        changes;              // insertions + removals
+
+} presence_t;
+
+extern presence_t       cardPresence;
+
+void presence_Init(void);
+
+#endif // _PRESENCE_H_
@@ -0,0 +1,56 @@
+#ifndef _PROTO_H_
+#define _PROTO_H_
+//===================================================================
+// proto.hpp
+// Definitions for the binary framed protocol (see proto.cpp).
+//
+// Frames are COBS encoded and end with a 0x00 delimiter.  Decoded, a
+// frame is [type][request id][payload...][CRC16 lo][CRC16 hi], where
+// the CRC is CRC-16/CCITT-FALSE over everything before it.  Multi-byte
+// payload values are little endian.
+//===================================================================
+#include <stdint-gcc.h>
+
+#define PROTO_DELIM               0x00
+#define PROTO_FRAME_MAX           160       // decoded frame incl. type, id, CRC
+#define PROTO_OUT_CHUNK           128       // text bytes per PROTO_RSP_OUTPUT
+
+// request types (host -> board)
+#define PROTO_REQ_TEXT            0x01      // payload: command line, ';' lists allowed
+#define PROTO_REQ_CODE            0x02      // payload: cliCompile() bytecode
+#define PROTO_REQ_RAILS           0x10      // -> int32 12V mA, 12V mV, 3.3V mA, 3.3V mV
+#define PROTO_REQ_PINS            0x11      // -> u8 count, u32 levels (bit n = 'pins' entry n)
+#define PROTO_REQ_SCAN            0x12      // -> u32 scan chain shift register 0
+#define PROTO_REQ_PRESENT         0x13      // -> u8 card present
+#define PROTO_REQ_TEXT_MODE       0x7F      // back to the text CLI after the response
+
+// response types (board -> host), request id is echoed
+#define PROTO_RSP_OUTPUT          0x80      // payload: command output text, 0 or more
+#define PROTO_RSP_DONE            0x81      // payload: status, then request specific data
+
+// unsolicited event frames (board -> host), request id is 0
+#define PROTO_EVT_PRESENCE        0x90      // payload: u8 present, u8 PRSNTB[3:0], u32 insertion ms
+
+// PROTO_RSP_DONE status
+#define PROTO_OK                  0
+#define PROTO_ERR_CMD             1         // (last) command returned an error
+#define PROTO_ERR_REJECTED        2         // CLI rejected the command or bytecode
+#define PROTO_ERR_TYPE            3         // unknown request type
+#define PROTO_ERR_CRC             4         // bad CRC or frame too short
+#define PROTO_ERR_LENGTH          5         // frame too long
+
+// 'mode' command keywords, list order must match the enum
+#define PROTO_MODE_KEYWORDS       "binary|text"
+
+typedef enum {
+    PROTO_MODE_BINARY = 0,
+    PROTO_MODE_TEXT,
+
+} proto_mode_t;
+
+bool proto_service(void);
+bool proto_active(void);
+bool proto_event(uint8_t type, const uint8_t *data, uint16_t len);
+int modeCmd(int argCnt);
+
+#endif // _PROTO_H_
@@ -0,0 +1,21 @@
+#ifndef _SCHED_H_
+#define _SCHED_H_
+//===================================================================
+// sched.hpp
+// Definitions for the cooperative task scheduler (see sched.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+#define SCHED_TASK_MAX            8
+
+// task function, runs to completion each time it is due
+typedef void (*sched_func_t)(void);
+
+int sched_add(const char *name, sched_func_t func, uint32_t periodMs, uint32_t delayMs);
+void sched_start(int id, uint32_t delayMs);
+void sched_stop(int id);
+void sched_run(void);
+void sched_reset(void);
+void sched_show(void);
+
+#endif // _SCHED_H_
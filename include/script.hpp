@@ -0,0 +1,43 @@
+#ifndef _SCRIPT_H_
+#define _SCRIPT_H_
+//===================================================================
+// script.hpp
+// Definitions for stored command scripts (see script.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+// script store lives in simulated EEPROM after EEPROM_data_t
+#define SCRIPT_STORE_ADDR         64
+#define SCRIPT_NAME_MAX           16        // including NUL
+#define SCRIPT_CODE_MAX           200       // bytecode per script
+
+// how often card presence is checked for autorun, msecs
+#define SCRIPT_PRESENCE_POLL_MS   250
+
+// 'script' subcommands, list order must match the enum
+#define SCRIPT_SUBCMD_KEYWORDS    "list|add|del|auto"
+
+typedef enum {
+    SCRIPT_LIST = 0,
+    SCRIPT_ADD,
+    SCRIPT_DEL,
+    SCRIPT_AUTO,
+
+} script_subcmd_t;
+
+// script store header, followed by 'used' bytes of records; each
+// record is [record length][name + NUL][bytecode from cliCompile()]
+typedef struct {
+    uint32_t        sig;
+    uint32_t        registryId;           // cliRegistryId() the code was built for
+    uint16_t        used;
+    char            autorun[SCRIPT_NAME_MAX];   // run on card insertion, "" for none
+
+} script_hdr_t;
+
+void script_Init(void);
+void script_service(void);
+int scriptCmd(int argCnt);
+int runCmd(int argCnt);
+
+#endif // _SCRIPT_H_
@@ -0,0 +1,41 @@
+#ifndef _TERMINAL_H_
+#define _TERMINAL_H_
+//===================================================================
+// terminal.hpp
+// Definitions for buffered terminal I/O (see terminal.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+// TX ring size in bytes, must be a power of 2
+#define TERM_TX_RING_SIZE         1024
+
+// staging buffer for large outputs sent as one multi-packet transfer
+#define TERM_BULK_SIZE            1024
+
+// RX ring size in bytes, must be a power of 2
+#define TERM_RX_RING_SIZE         512
+
+// output redirection target, see term_setSink()
+typedef void (*term_sink_t)(const char *s, uint16_t len);
+
+void term_setSink(term_sink_t sink);
+void term_write(const char *s, uint16_t len);
+void term_writeRaw(const char *s, uint16_t len);
+void term_puts(const char *s);
+void term_putc(char c);
+void term_service(void);
+void term_flush(void);
+void term_bulkWrite(const char *s, uint16_t len);
+char *term_bulkReserve(uint16_t n);
+void term_bulkCommit(uint16_t n);
+void term_bulkFlush(void);
+uint32_t term_outCount(void);
+void term_rxPoll(void);
+int term_getc(void);
+int term_peek(void);
+bool term_break(void);
+void term_rxFlush(void);
+void term_lineFlush(void);
+bool term_getLine(char *line, uint16_t size);
+
+#endif // _TERMINAL_H_
@@ -0,0 +1,11 @@
+#ifndef _USBCORE_H_
+#define _USBCORE_H_
+//===================================================================
+// usbcore.hpp
+// OCP additions to the USB device driver (see USBCore.cpp).
+//===================================================================
+#include <stdint-gcc.h>
+
+uint32_t usb_sendBulk(const void *data, uint32_t len);
+
+#endif // _USBCORE_H_
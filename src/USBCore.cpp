@@ -30,6 +30,7 @@
 #include "USB/SAMD21_USBDevice.h"
 #include "USB/CDC.h"
 #warning Using expected USBCore.cpp with OCP modifications
+#include "usbcore.hpp"
 // end modification
 
 #include "api/PluggableUSB.h"
@@ -112,6 +113,151 @@ uint8_t udd_ep_in_cache_buffer[7][64];
 // converted into reusable EPHandlers in the future.
 static EPHandler *epHandlers[7] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL};
 
+// Timeout for sends
+#define TX_TIMEOUT_MS 70
+
+static char LastTransmitTimedOut[7] = {
+	0,
+	0,
+	0,
+	0,
+	0,
+	0,
+	0
+};
+
+// OCP: IN packet coalescing for the CDC bulk IN endpoint.
+// Small writes are packed into full size packets.  Two packet buffers
+// are used so the CPU fills one while the other is on the wire.  A
+// partly filled buffer goes out on flush() or after the endpoint has
+// been idle for TX_COALESCE_FRAMES start-of-frames (1 ms each).
+#define TX_COALESCE_FRAMES 2
+
+// OCP: largest usb_sendBulk() transfer, PCKSIZE.BYTE_COUNT is 14 bits
+#define TX_BULK_MAX 16383
+
+typedef struct {
+	uint8_t buffer[2][EPX_SIZE] __attribute__((__aligned__(4)));
+	volatile uint8_t ep;		// bulk IN endpoint, 0 = none bound
+	volatile uint8_t fill;		// index of buffer being filled
+	volatile uint8_t count;		// bytes in the fill buffer
+	volatile uint8_t idle;		// frames since the last write
+} EPInCoalescer;
+
+static EPInCoalescer txPack;
+
+// Wait for the bank in flight (if any) to go out.  Called with the USB
+// IRQ enabled so SOF, setup and OUT traffic are still serviced.
+static bool txPackWait(uint32_t ep)
+{
+	// convert the timeout from microseconds to a number of times through
+	// the wait loop; it takes (roughly) 23 clock cycles per iteration.
+	uint32_t timeout = microsecondsToClockCycles(TX_TIMEOUT_MS * 1000) / 23;
+
+	// BK1RDY is cleared by hardware once the IN transaction completes;
+	// unlike TRCPT1 it is not acknowledged behind our back by the ISR
+	while (usbd.epBank1IsReady(ep)) {
+		if (LastTransmitTimedOut[ep] || timeout-- == 0) {
+			LastTransmitTimedOut[ep] = 1;
+			return false;
+		}
+	}
+
+	LastTransmitTimedOut[ep] = 0;
+	return true;
+}
+
+// Hand the fill buffer to the controller and switch to the other one.
+// Caller guarantees the bank is free and the USB IRQ can't interfere.
+// last is true when nothing else is queued behind this packet: a full
+// packet then needs a ZLP to end the transfer, while mid-stream a ZLP
+// after every packet would cost an extra IN transaction each.
+static void txPackArm(uint32_t ep, bool last)
+{
+	uint8_t *buffer = txPack.buffer[txPack.fill];
+
+	if (last && txPack.count == EPX_SIZE)
+		usbd.epBank1EnableAutoZLP(ep);
+	else
+		usbd.epBank1DisableAutoZLP(ep);
+
+	usbd.epBank1SetAddress(ep, buffer);
+	usbd.epBank1SetMultiPacketSize(ep, 0);
+	usbd.epBank1SetByteCount(ep, txPack.count);
+
+	// Clear the transfer complete flag
+	usbd.epBank1AckTransferComplete(ep);
+
+	// RAM buffer is full, we can send data (IN)
+	usbd.epBank1SetReady(ep);
+
+	txPack.fill ^= 1;
+	txPack.count = 0;
+	txPack.idle = 0;
+}
+
+// Wait for the bank to free up, then send the fill buffer unless the
+// SOF tick already did.  Only the hand over runs with the USB IRQ off.
+static bool txPackPush(uint32_t ep, bool last)
+{
+	bool ok = txPackWait(ep);
+
+	NVIC_DisableIRQ((IRQn_Type) USB_IRQn);
+	if (!ok) {
+		// drop the stale packet so a ZLP isn't followed by garbage
+		txPack.count = 0;
+	} else if (txPack.count && !usbd.epBank1IsReady(ep)) {
+		txPackArm(ep, last);
+	}
+	NVIC_EnableIRQ((IRQn_Type) USB_IRQn);
+
+	return ok;
+}
+
+// Start-of-frame tick: send a partial packet once writes have paused
+static void txPackFrame(void)
+{
+	uint32_t ep = txPack.ep;
+
+	if (ep == 0 || txPack.count == 0)
+		return;
+
+	if (++txPack.idle >= TX_COALESCE_FRAMES && !usbd.epBank1IsReady(ep))
+		txPackArm(ep, true);
+}
+
+// Coalescing send; returns bytes accepted or -1 on timeout.  A packet
+// filled by this write is left for the next write, flush() or the SOF
+// tick, since only they know whether more data follows it.
+static uint32_t txPackSend(uint32_t ep, const uint8_t *data, uint32_t len)
+{
+	uint32_t written = 0;
+	uint32_t length;
+
+	while (len != 0)
+	{
+		// more data follows a packet that is already full
+		if (txPack.count == EPX_SIZE && !txPackPush(ep, false))
+			return -1;
+
+		NVIC_DisableIRQ((IRQn_Type) USB_IRQn);
+		length = EPX_SIZE - txPack.count;
+		if (length > len)
+			length = len;
+
+		memcpy(&txPack.buffer[txPack.fill][txPack.count], data, length);
+		txPack.count += length;
+		txPack.idle = 0;
+		NVIC_EnableIRQ((IRQn_Type) USB_IRQn);
+
+		written += length;
+		len -= length;
+		data += length;
+	}
+
+	return written;
+}
+
 //==================================================================
 
 // Send a USB descriptor string. The string is stored as a
@@ -436,6 +582,12 @@ void USBDeviceClass::initEP(uint32_t ep, uint32_t config)
 		usbd.epBank1SetSize(ep, 64);
 		usbd.epBank1SetAddress(ep, &udd_ep_in_cache_buffer[ep]);
 		usbd.epBank1SetType(ep, 3); // BULK IN
+
+		// OCP: writes to this endpoint are coalesced, see send()
+		txPack.ep = ep;
+		txPack.fill = 0;
+		txPack.count = 0;
+		txPack.idle = 0;
 	}
 	else if (config == USB_ENDPOINT_TYPE_CONTROL)
 	{
@@ -456,6 +608,13 @@ void USBDeviceClass::initEP(uint32_t ep, uint32_t config)
 
 void USBDeviceClass::flush(uint32_t ep)
 {
+	// OCP: push out a partly filled coalesced packet
+	if (ep == txPack.ep) {
+		if (txPack.count)
+			txPackPush(ep, true);
+		return;
+	}
+
 	if (available(ep)) {
 		// RAM buffer is full, we can send data (IN)
 		usbd.epBank1SetReady(ep);
@@ -600,19 +759,6 @@ uint8_t USBDeviceClass::armRecvCtrlOUT(uint32_t ep)
 	return usbd.epBank0ByteCount(ep);
 }
 
-// Timeout for sends
-#define TX_TIMEOUT_MS 70
-
-static char LastTransmitTimedOut[7] = {
-	0,
-	0,
-	0,
-	0,
-	0,
-	0,
-	0
-};
-
 // Blocking Send of data to an endpoint
 uint32_t USBDeviceClass::send(uint32_t ep, const void *data, uint32_t len)
 {
@@ -631,6 +777,10 @@ uint32_t USBDeviceClass::send(uint32_t ep, const void *data, uint32_t len)
 	txLEDPulse = TX_RX_LED_PULSE_MS;
 #endif
 
+	// OCP: pack small writes into full packets on the CDC data endpoint
+	if (ep == txPack.ep)
+		return txPackSend(ep, (const uint8_t *)data, len);
+
 	// Flash area
 	while (len != 0)
 	{
@@ -683,6 +833,71 @@ uint32_t USBDeviceClass::send(uint32_t ep, const void *data, uint32_t len)
 	return written;
 }
 
+// OCP: Blocking multi-packet send of a RAM buffer to the CDC data endpoint.
+// The controller splits the transfer into full size packets by itself
+// (MULTI_PACKET_SIZE counts the bytes sent) and appends a ZLP when the
+// length is a multiple of the packet size.  The buffer must be 32-bit
+// aligned and is read in place, so it must stay valid until return.
+uint32_t usb_sendBulk(const void *data, uint32_t len)
+{
+	uint32_t ep = txPack.ep;
+	uint32_t timeout;
+
+	if (!_usbConfiguration || ep == 0)
+		return -1;
+
+	// unaligned or oversized buffers take the packet at a time path
+	if (((uint32_t)data & 3) || len > TX_BULK_MAX)
+		return USBDevice.send(ep, data, len);
+
+	if (len == 0)
+		return 0;
+
+#ifdef PIN_LED_TXL
+	if (txLEDPulse == 0)
+		digitalWrite(PIN_LED_TXL, LOW);
+
+	txLEDPulse = TX_RX_LED_PULSE_MS;
+#endif
+
+	// anything already coalesced goes out first to keep the byte order
+	if (txPack.count && !txPackPush(ep, false))
+		return -1;
+
+	if (!txPackWait(ep))
+		return -1;
+
+	// the fill buffer is empty, so the SOF tick leaves the bank alone
+	NVIC_DisableIRQ((IRQn_Type) USB_IRQn);
+	usbd.epBank1SetAddress(ep, (void *)data);
+	usbd.epBank1SetMultiPacketSize(ep, 0);
+	usbd.epBank1SetByteCount(ep, len);
+	usbd.epBank1EnableAutoZLP(ep);
+
+	// Clear the transfer complete flag
+	usbd.epBank1AckTransferComplete(ep);
+
+	// RAM buffer is full, we can send data (IN)
+	usbd.epBank1SetReady(ep);
+
+	NVIC_EnableIRQ((IRQn_Type) USB_IRQn);
+
+	// allow the usual per-packet timeout for every packet in the transfer
+	timeout = (microsecondsToClockCycles(TX_TIMEOUT_MS * 1000) / 23) * (len / EPX_SIZE + 1);
+
+	while (usbd.epBank1IsReady(ep)) {
+		if (timeout-- == 0) {
+			// host stopped reading: take the bank back so the
+			// controller doesn't read the buffer after we return
+			usbd.epBank1ResetReady(ep);
+			LastTransmitTimedOut[ep] = 1;
+			return -1;
+		}
+	}
+
+	return len;
+}
+
 uint32_t USBDeviceClass::armSend(uint32_t ep, const void* data, uint32_t len)
 {
 	memcpy(&udd_ep_in_cache_buffer[ep], data, len);
@@ -852,6 +1067,9 @@ void USBDeviceClass::ISRHandler()
 		usbd.epBank0EnableSetupReceived(0);
 
 		_usbConfiguration = 0;
+
+		// OCP: discard coalesced data from the previous session
+		txPack.count = 0;
 	}
 
 	// Start-Of-Frame
@@ -859,6 +1077,9 @@ void USBDeviceClass::ISRHandler()
 	{
 		usbd.ackStartOfFrameInterrupt();
 
+		// OCP: send any coalesced data that has been sitting idle
+		txPackFrame();
+
 		// check whether the one-shot period has elapsed.  if so, turn off the LED
 #ifdef PIN_LED_TXL
 		if (txLEDPulse > 0) {
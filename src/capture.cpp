@@ -0,0 +1,611 @@
+//===================================================================
+// capture.cpp
+// Pin capture mode, a small logic analyzer for the sideband pins.
+// TC4 interrupts at the sample rate and the handler reads both PORT
+// IN registers, masked to the staticPins[] pins.  Sideband signals
+// rarely change, so samples are stored run-length encoded: a ring of
+// runs, each a port snapshot and how many samples it lasted.  Until
+// the trigger the ring keeps the last 'pre' samples by trimming the
+// oldest run; after it 'post' more are taken and the timer is
+// stopped.  Storing a sample is a compare and either a count
+// increment or a new run, so the handler's cost doesn't depend on the
+// capture length.  The window only ends early if the pins change more
+// often than there are runs.
+//
+// Triggers are an edge on one pin, or a pattern over the pins (as a
+// bitmap, bit n = staticPins[n] as shown by 'pins') becoming true.
+// Results are shown as run-length records or as a VCD file that can
+// be loaded into a waveform viewer.
+//
+// TC5 is the scan chain clock, so this uses TC4; both run from the
+// same GCLK0 generic clock.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "commands.hpp"
+#include "capture.hpp"
+#include "fmt.hpp"
+
+extern uint16_t         static_pin_count;
+
+#define CAPTURE_LINE_MAX          64
+
+typedef enum {
+    CAP_IDLE = 0,
+    CAP_PRE,                // filling the ring, waiting for the trigger
+    CAP_POST,               // triggered, taking the post-trigger samples
+    CAP_DONE,
+    CAP_STOPPED,            // stopped by a key before it finished
+
+} cap_state_t;
+
+static char             outBfr[OUTBFR_SIZE];
+
+// a run of identical samples, PORTA and PORTB IN with only the
+// staticPins[] bits
+typedef struct {
+    uint32_t        port[2];
+    uint32_t        count;
+
+} cap_run_t;
+
+static cap_run_t        capRuns[CAPTURE_RUNS_MAX];
+static uint32_t         capMask[2];
+
+static volatile cap_state_t capState = CAP_IDLE;
+static volatile uint16_t capTail;               // oldest run
+static volatile uint16_t capRunCnt;             // runs held
+static volatile uint32_t capCount;              // samples held, sum of the runs
+static volatile uint32_t capPostLeft;
+static volatile uint32_t capTrigAt;             // trigger sample number
+static volatile bool    capFull;                // ran out of runs after the trigger
+static uint32_t         capPre;
+static uint32_t         capPost;
+static uint32_t         capRate;                // actual rate, Hz
+
+// trigger: edge is any change in trigMask, the others the masked
+// sample becoming equal to trigVal
+static capture_trigger_t capTrig;
+static uint32_t         trigMask[2];
+static uint32_t         trigVal[2];
+static uint32_t         capPrev[2];
+
+// TC prescaler choices, lowest first
+static const struct {
+    uint16_t        div;
+    uint32_t        bits;
+
+} capPrescale[] = {
+    {    1, TC_CTRLA_PRESCALER_DIV1 },
+    {    8, TC_CTRLA_PRESCALER_DIV8 },
+    {   64, TC_CTRLA_PRESCALER_DIV64 },
+    {  256, TC_CTRLA_PRESCALER_DIV256 },
+    { 1024, TC_CTRLA_PRESCALER_DIV1024 },
+};
+
+/**
+  * @name   captureSync
+  * @brief  wait for TC4 register sync
+  * @param  None
+  * @retval None
+  */
+static void captureSync(void)
+{
+    while ( TC4->COUNT16.STATUS.reg & TC_STATUS_SYNCBUSY )
+        ;
+}
+
+/**
+  * @name   captureTimerStart
+  * @brief  start TC4 interrupting at a sample rate
+  * @param  rate samples per second
+  * @retval actual rate, Hz
+  */
+static uint32_t captureTimerStart(uint32_t rate)
+{
+    uint32_t        ticks;
+    unsigned        i;
+
+    // smallest prescaler (finest resolution) that fits the period in 16 bits
+    for ( i = 0; i < sizeof(capPrescale) / sizeof(capPrescale[0]) - 1; i++ )
+    {
+        if ( SystemCoreClock / capPrescale[i].div / rate <= 0x10000 )
+            break;
+    }
+
+    ticks = SystemCoreClock / capPrescale[i].div / rate;
+    if ( ticks > 0x10000 )
+        ticks = 0x10000;
+
+    GCLK->CLKCTRL.reg = (uint16_t) (GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_ID(GCM_TC4_TC5));
+    while ( GCLK->STATUS.bit.SYNCBUSY )
+        ;
+
+    TC4->COUNT16.CTRLA.reg = TC_CTRLA_SWRST;
+    captureSync();
+    while ( TC4->COUNT16.CTRLA.bit.SWRST )
+        ;
+
+    TC4->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MFRQ | capPrescale[i].bits;
+    TC4->COUNT16.CC[0].reg = (uint16_t) (ticks - 1);
+    captureSync();
+
+    NVIC_DisableIRQ(TC4_IRQn);
+    NVIC_ClearPendingIRQ(TC4_IRQn);
+    NVIC_SetPriority(TC4_IRQn, 1);
+    NVIC_EnableIRQ(TC4_IRQn);
+
+    TC4->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+    TC4->COUNT16.CTRLA.reg |= TC_CTRLA_ENABLE;
+    captureSync();
+
+    return(SystemCoreClock / capPrescale[i].div / ticks);
+}
+
+/**
+  * @name   captureTimerStop
+  * @brief  stop TC4
+  * @param  None
+  * @retval None
+  */
+static void captureTimerStop(void)
+{
+    TC4->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+    captureSync();
+    NVIC_DisableIRQ(TC4_IRQn);
+}
+
+/**
+  * @name   TC4_Handler
+  * @brief  take one sample
+  * @param  None
+  * @retval None
+  */
+void TC4_Handler(void)
+{
+    uint32_t        a = PORT->Group[PORTA].IN.reg & capMask[PORTA];
+    uint32_t        b = PORT->Group[PORTB].IN.reg & capMask[PORTB];
+    bool            hit;
+    cap_run_t       *run;
+    uint16_t        slot;
+
+    TC4->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+
+    if ( capState != CAP_PRE && capState != CAP_POST )
+        return;
+
+    slot = capTail + capRunCnt;
+    if ( slot >= CAPTURE_RUNS_MAX )
+        slot -= CAPTURE_RUNS_MAX;
+    run = &capRuns[(slot == 0 ? CAPTURE_RUNS_MAX : slot) - 1];
+
+    if ( capRunCnt > 0 && run->port[PORTA] == a && run->port[PORTB] == b )
+    {
+        run->count++;
+    }
+    else
+    {
+        if ( capRunCnt == CAPTURE_RUNS_MAX )
+        {
+            if ( capState == CAP_POST )
+            {
+                // keep what led up to the trigger, end the window here
+                capFull = true;
+                capState = CAP_DONE;
+                TC4->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+                return;
+            }
+
+            // before the trigger, give up the oldest history
+            capCount -= capRuns[capTail].count;
+            if ( ++capTail == CAPTURE_RUNS_MAX )
+                capTail = 0;
+            capRunCnt--;
+        }
+
+        run = &capRuns[slot];
+        run->port[PORTA] = a;
+        run->port[PORTB] = b;
+        run->count = 1;
+        capRunCnt++;
+    }
+    capCount++;
+
+    if ( capState == CAP_PRE )
+    {
+        if ( capTrig == CAPTURE_TRIG_NOW )
+            hit = true;
+        else if ( capTrig == CAPTURE_TRIG_EDGE )
+            hit = ((a ^ capPrev[PORTA]) & trigMask[PORTA]) || ((b ^ capPrev[PORTB]) & trigMask[PORTB]);
+        else
+            hit = (a & trigMask[PORTA]) == trigVal[PORTA] && (b & trigMask[PORTB]) == trigVal[PORTB] &&
+                  ((capPrev[PORTA] & trigMask[PORTA]) != trigVal[PORTA] || (capPrev[PORTB] & trigMask[PORTB]) != trigVal[PORTB]);
+
+        capPrev[PORTA] = a;
+        capPrev[PORTB] = b;
+
+        if ( !hit )
+        {
+            // only 'pre' samples are kept ahead of the trigger
+            if ( capCount > capPre )
+            {
+                capCount--;
+                if ( --capRuns[capTail].count == 0 )
+                {
+                    if ( ++capTail == CAPTURE_RUNS_MAX )
+                        capTail = 0;
+                    capRunCnt--;
+                }
+            }
+            return;
+        }
+
+        // the trigger sample is the first post-trigger sample
+        capState = CAP_POST;
+        capPostLeft = capPost;
+        capTrigAt = capCount - 1;
+    }
+
+    if ( --capPostLeft == 0 )
+    {
+        capState = CAP_DONE;
+        TC4->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+    }
+}
+
+/**
+  * @name   captureRun
+  * @brief  a captured run in time order
+  * @param  n run number, 0 is the oldest
+  * @retval run
+  */
+static const cap_run_t *captureRun(int n)
+{
+    int             slot = capTail + n;
+
+    if ( slot >= CAPTURE_RUNS_MAX )
+        slot -= CAPTURE_RUNS_MAX;
+
+    return(&capRuns[slot]);
+}
+
+/**
+  * @name   captureLevel
+  * @brief  one pin's level in a run
+  * @param  r run
+  * @param  index staticPins[] index
+  * @retval 0 or 1
+  */
+static int captureLevel(const cap_run_t *r, int index)
+{
+    uint8_t         port;
+    uint32_t        mask = getPinPortMask(index, &port);
+
+    return((r->port[port] & mask) ? 1 : 0);
+}
+
+/**
+  * @name   capturePack
+  * @brief  a run's pins as a bitmap
+  * @param  r run
+  * @retval bit n is staticPins[n]
+  */
+static uint32_t capturePack(const cap_run_t *r)
+{
+    uint32_t        pins = 0;
+
+    for ( int i = 0; i < static_pin_count && i < 32; i++ )
+        pins |= (uint32_t) captureLevel(r, i) << i;
+
+    return(pins);
+}
+
+/**
+  * @name   captureTimeUs
+  * @brief  time of a sample from the first one
+  * @param  n sample number
+  * @retval usecs
+  */
+static uint32_t captureTimeUs(uint32_t n)
+{
+    return((uint32_t) ((uint64_t) n * 1000000 / capRate));
+}
+
+/**
+  * @name   captureSummary
+  * @brief  show what the last capture holds
+  * @param  None
+  * @retval None
+  */
+static void captureSummary(void)
+{
+    char            *t;
+
+    if ( capState == CAP_IDLE || capCount == 0 )
+    {
+        terminalOut((char *) "No capture, use 'capture arm ...'");
+        return;
+    }
+
+    t = fmt_u32(fmt_str(outBfr, "Capture: "), capCount);
+    t = fmt_u32(fmt_str(t, " samples in "), capRunCnt);
+    t = fmt_u32(fmt_str(t, " runs at "), capRate);
+    t = fmt_str(t, " Hz");
+
+    if ( capState != CAP_DONE )
+        t = fmt_str(t, ", stopped before it finished");
+    else
+        t = fmt_u32(fmt_str(t, ", trigger at sample "), capTrigAt);
+
+    if ( capFull )
+        t = fmt_str(t, ", out of runs");
+
+    SHOW();
+}
+
+/**
+  * @name   captureRle
+  * @brief  send the capture as run-length records
+  * @param  None
+  * @retval None
+  * @note   one line per run: first sample, run length, pin bitmap
+  */
+static void captureRle(void)
+{
+    const cap_run_t *r;
+    char            *line;
+    char            *t;
+    uint32_t        start = 0;
+
+    captureSummary();
+    terminalOut((char *) "sample  count  pins");
+
+    for ( int n = 0; n < capRunCnt; n++ )
+    {
+        r = captureRun(n);
+
+        line = t = term_bulkReserve(CAPTURE_LINE_MAX);
+        t = fmt_u32(t, start);
+        t = fmt_u32(fmt_str(t, " "), r->count);
+        t = fmt_hex(fmt_str(t, " "), capturePack(r), 8);
+        t = fmt_str(t, "\r\n");
+        term_bulkCommit(t - line);
+
+        start += r->count;
+    }
+
+    term_bulkFlush();
+}
+
+/**
+  * @name   captureVcd
+  * @brief  send the capture as a VCD file
+  * @param  None
+  * @retval None
+  * @note   signal ids are '!' + staticPins[] index; time is in usecs
+  *         from the first sample
+  */
+static void captureVcd(void)
+{
+    const cap_run_t *prev = NULL;
+    const cap_run_t *r;
+    uint32_t        start = 0;
+    char            *line;
+    char            *t;
+    int             level;
+
+    term_bulkWrite("$timescale 1 us $end\r\n$scope module ocp $end\r\n", 46);
+
+    for ( int i = 0; i < static_pin_count; i++ )
+    {
+        line = t = term_bulkReserve(CAPTURE_LINE_MAX);
+        t = fmt_str(t, "$var wire 1 ");
+        *t++ = '!' + i;
+        t = fmt_str(fmt_str(t, " "), getPinByIndex(i)->name);
+        t = fmt_str(t, " $end\r\n");
+        term_bulkCommit(t - line);
+    }
+
+    line = t = term_bulkReserve(CAPTURE_LINE_MAX);
+    t = fmt_str(t, "$upscope $end\r\n$enddefinitions $end\r\n");
+    if ( capState == CAP_DONE )
+        t = fmt_str(fmt_u32(fmt_str(t, "$comment trigger at #"), captureTimeUs(capTrigAt)), " $end\r\n");
+    term_bulkCommit(t - line);
+
+    // each run is a value change, the first one dumps every pin
+    for ( int n = 0; n < capRunCnt; n++ )
+    {
+        r = captureRun(n);
+
+        line = t = term_bulkReserve(CAPTURE_LINE_MAX);
+        t = fmt_str(fmt_u32(fmt_str(t, "#"), captureTimeUs(start)), "\r\n");
+        term_bulkCommit(t - line);
+
+        for ( int i = 0; i < static_pin_count; i++ )
+        {
+            level = captureLevel(r, i);
+            if ( prev != NULL && level == captureLevel(prev, i) )
+                continue;
+
+            line = term_bulkReserve(4);
+            line[0] = '0' + level;
+            line[1] = '!' + i;
+            line[2] = '\r';
+            line[3] = '\n';
+            term_bulkCommit(4);
+        }
+
+        prev = r;
+        start += r->count;
+    }
+
+    // end of the window, so the last run keeps its length
+    line = t = term_bulkReserve(CAPTURE_LINE_MAX);
+    t = fmt_str(fmt_u32(fmt_str(t, "#"), captureTimeUs(capCount)), "\r\n");
+    term_bulkCommit(t - line);
+
+    term_bulkFlush();
+}
+
+/**
+  * @name   captureStep
+  * @brief  capture job, waits for the capture to finish
+  * @param  cancel true when a key was pressed
+  * @retval CLI_JOB_RUNNING until done, then 0; 1 when cancelled
+  */
+static int captureStep(bool cancel)
+{
+    if ( cancel )
+    {
+        captureTimerStop();
+        capState = (capCount > 0) ? CAP_STOPPED : CAP_IDLE;
+        terminalOut((char *) "Capture stopped");
+        captureSummary();
+        return(1);
+    }
+
+    if ( capState != CAP_DONE )
+        return(CLI_JOB_RUNNING);
+
+    captureTimerStop();
+    captureSummary();
+    return(0);
+}
+
+/**
+  * @name   captureArm
+  * @brief  set up the trigger and start sampling
+  * @param  argCnt number of CLI arguments
+  * @retval 0 OK, 1 bad arguments
+  * @note   cliArgs[1..6] are rate, pre, post, trigger, pin or pattern
+  *         mask, pattern value
+  */
+static int captureArm(int argCnt)
+{
+    uint32_t        rate = cliArgs[1].i;
+    int             pre = cliArgs[2].i;
+    int             post = cliArgs[3].i;
+    uint32_t        pattern;
+    uint32_t        value = cliArgs[6].present ? cliArgs[6].u : 0;
+    uint8_t         port;
+    uint32_t        mask;
+    int             pinNo;
+    char            *end;
+
+    if ( argCnt < 4 )
+    {
+        terminalOut((char *) "Usage: capture arm <rate_hz> <pre> <post> [trigger] [pin | mask] [value]");
+        return(1);
+    }
+
+    capTrig = cliArgs[4].present ? (capture_trigger_t) cliArgs[4].i : CAPTURE_TRIG_NOW;
+    trigMask[PORTA] = trigMask[PORTB] = 0;
+    trigVal[PORTA] = trigVal[PORTB] = 0;
+
+    if ( capTrig != CAPTURE_TRIG_NOW && !cliArgs[5].present )
+    {
+        terminalOut((char *) "Trigger needs a pin, or a mask for 'pattern'");
+        return(1);
+    }
+
+    // a trigger may never come, and only a key stops the wait
+    if ( capTrig != CAPTURE_TRIG_NOW && !cliJobDetached() )
+    {
+        terminalOut((char *) "Triggered captures only run at the prompt, use trigger 'now'");
+        return(1);
+    }
+
+    if ( capTrig == CAPTURE_TRIG_PATTERN )
+    {
+        // bitmap over staticPins[] -> PORT masks
+        pattern = strtoul(cliArgs[5].s, &end, 16);
+        if ( *end != '\0' || end == cliArgs[5].s || (pattern & (0xFFFFFFFFUL >> (32 - static_pin_count))) == 0 )
+        {
+            terminalOut((char *) "Pattern mask must be non-zero hex, bit n = 'pins' entry n");
+            return(1);
+        }
+
+        for ( int i = 0; i < static_pin_count && i < 32; i++ )
+        {
+            if ( (pattern & (1UL << i)) == 0 )
+                continue;
+
+            mask = getPinPortMask(i, &port);
+            trigMask[port] |= mask;
+            if ( value & (1UL << i) )
+                trigVal[port] |= mask;
+        }
+    }
+    else if ( capTrig != CAPTURE_TRIG_NOW )
+    {
+        pinNo = cliParsePin(cliArgs[5].s);
+        if ( pinNo < 0 )
+        {
+            terminalOut((char *) "Unknown trigger pin, see 'pins'");
+            return(1);
+        }
+
+        mask = getPinPortMask(getPinIndex(pinNo), &port);
+        trigMask[port] = mask;
+        trigVal[port] = (capTrig == CAPTURE_TRIG_FALL) ? 0 : mask;
+    }
+
+    // sample every staticPins[] pin, outputs read back their level
+    capMask[PORTA] = capMask[PORTB] = 0;
+    for ( int i = 0; i < static_pin_count; i++ )
+    {
+        mask = getPinPortMask(i, &port);
+        capMask[port] |= mask;
+    }
+
+    captureTimerStop();
+    capPre = pre;
+    capPost = post;
+    capTail = 0;
+    capRunCnt = 0;
+    capCount = 0;
+    capTrigAt = 0;
+    capFull = false;
+    capPrev[PORTA] = PORT->Group[PORTA].IN.reg & capMask[PORTA];
+    capPrev[PORTB] = PORT->Group[PORTB].IN.reg & capMask[PORTB];
+    capState = CAP_PRE;
+    capRate = captureTimerStart(rate);
+
+    sprintf(outBfr, "Capturing at %lu Hz, waiting for trigger, hit any key to stop", (unsigned long) capRate);
+    SHOW();
+
+    return(cliJobStart(captureStep));
+}
+
+/**
+  * @name   captureCmd
+  * @brief  pin capture (logic analyzer)
+  * @param  argCnt number of CLI arguments
+  * @param  cliArgs[0] CAPTURE_ARM, CAPTURE_RLE or CAPTURE_VCD
+  * @retval 0 OK, 1 error
+  * @note   with no arguments shows what the last capture holds
+  */
+int captureCmd(int argCnt)
+{
+    if ( argCnt == 0 )
+    {
+        captureSummary();
+        return(0);
+    }
+
+    if ( cliArgs[0].i == CAPTURE_ARM )
+        return(captureArm(argCnt));
+
+    if ( capCount == 0 || capState == CAP_PRE || capState == CAP_POST )
+    {
+        terminalOut((char *) "No finished capture");
+        return(1);
+    }
+
+    if ( cliArgs[0].i == CAPTURE_RLE )
+        captureRle();
+    else
+        captureVcd();
+
+    return(0);
+}
@@ -7,6 +7,14 @@
 #include "main.hpp"
 #include "cli.hpp"
 #include "commands.hpp"
+#include "eeprom.hpp"
+#include "debug.hpp"
+#include "fmt.hpp"
+#include "script.hpp"
+#include "proto.hpp"
+#include "perf.hpp"
+#include "events.hpp"
+#include "capture.hpp"
 
 // Constant Data
 const char      cliPrompt[] = "cmd> ";
@@ -15,52 +23,194 @@ const char      hello[] = "OCP Xavier NIC 3.0 Test Board V";
 
 // CLI token stack and formatting buffer
 char            *tokens[MAX_TOKENS];
+cli_arg_t       cliArgs[MAX_ARGS];
 static char     outBfr[OUTBFR_SIZE];
+static int      cliStatus = 0;
+
+// command job, see cliJobStart()
+static cli_job_t    cliJob = NULL;
+static int          cliDepth = 0;           // nested cliDispatch() calls
+static bool         cliInteractive = false; // running a line typed at the prompt
+static bool         cliDetach = false;      // a job may continue from loop()
+static int          cliJobCmd = -1;         // command table index of a background job
+static uint32_t     cliJobStartUs;          // and its perf_cmdRecord() start
+static uint32_t     cliJobBytes;
+
+// repeat job, see repeatCmd()
+static char         repeatLine[MAX_LINE_SZ];
+static int32_t      repeatCount;
+static int32_t      repeatN;
+static uint32_t     repeatInterval;
+static uint32_t     repeatStart;            // millis() of the first run
+static uint32_t     repeatDue;              // millis() the next run is due
+static bool         repeatBusy = false;
 
 // CLI Command Table structure
+// the table is const and holds only pointers, so it and all the
+// help text stay in flash instead of being copied into SRAM
 typedef struct {
-    char        cmd[CMD_NAME_MAX];
-    int         (*func) (int x);
-    int         argCount;
-    char        help1[MAX_LINE_SZ];
-    char        help2[MAX_LINE_SZ];
+    const char              *cmd;
+    int                     (*func) (int x);
+    uint8_t                 minArgs;
+    uint8_t                 maxArgs;
+    uint8_t                 sigCnt;
+    const cli_arg_spec_t    *sig;
+    const char              *help1;
+    const char              *help2;
 
 } cli_entry;
 
-// command functions
-int curCmd(int);
-int writeCmd(int arg);
-int readCmd(int arg);
-int setCmd(int arg);
-int pinCmd(int arg);
-int debug(int arg);
-int statusCmd(int arg);
-int eepromCmd(int arg);
-int pwrCmd(int arg);
-int versCmd(int arg);
-int scanCmd(int arg);
-
-// CLI command table
-// CLI_COMMAND_CNT is defined in cli.hpp
-// format is "command", function, required arg count, "help line 1", "help line 2" 
-// NOTE: -1 as arg count means "don't check arguments"
+// Command signatures: one spec per argument in order, parsed into
+// cliArgs[] by cli() before the command function is called
+#define CLI_NO_ARGS         nullptr
+
+static constexpr cli_arg_spec_t captureSig[] = {
+    CLI_ARG_KEYWORD("subcommand", CAPTURE_SUBCMD_KEYWORDS),
+    CLI_ARG_INT("rate_hz", 1, CAPTURE_RATE_MAX),
+    CLI_ARG_INT("pre", 0, CAPTURE_SAMPLES_MAX),
+    CLI_ARG_INT("post", 1, CAPTURE_SAMPLES_MAX),
+    CLI_ARG_KEYWORD("trigger", CAPTURE_TRIGGER_KEYWORDS),
+    CLI_ARG_STRING("pin|mask"),
+    CLI_ARG_HEX("value", 0, 0xFFFFFFFF),
+};
+
+static constexpr cli_arg_spec_t eepromSig[] = {
+    CLI_ARG_KEYWORD("subcommand", EEPROM_SUBCMD_KEYWORDS),
+    CLI_ARG_INT("offset", 0, MAX_EEPROM_ADDR),
+    CLI_ARG_INT("length", 0, MAX_EEPROM_ADDR + 1),
+};
+
+static constexpr cli_arg_spec_t eventsSig[] = {
+    CLI_ARG_KEYWORD("subcommand", EVENTS_SUBCMD_KEYWORDS),
+};
+
+static constexpr cli_arg_spec_t modeSig[] = {
+    CLI_ARG_KEYWORD("mode", PROTO_MODE_KEYWORDS),
+};
+
+static constexpr cli_arg_spec_t pwrSig[] = {
+    CLI_ARG_KEYWORD("action", PWR_ACTION_KEYWORDS),
+    CLI_ARG_KEYWORD("target", PWR_TARGET_KEYWORDS),
+};
+
+static constexpr cli_arg_spec_t readSig[] = {
+    CLI_ARG_PIN("pin"),
+};
+
+static constexpr cli_arg_spec_t repeatSig[] = {
+    CLI_ARG_INT("count", 1, 100000),
+    CLI_ARG_REST("command"),
+};
+
+static constexpr cli_arg_spec_t runSig[] = {
+    CLI_ARG_STRING("name"),
+};
+
+static constexpr cli_arg_spec_t scriptSig[] = {
+    CLI_ARG_KEYWORD("subcommand", SCRIPT_SUBCMD_KEYWORDS),
+    CLI_ARG_STRING("name"),
+    CLI_ARG_REST("command"),
+};
+
+static constexpr cli_arg_spec_t setSig[] = {
+    CLI_ARG_KEYWORD("param", SET_PARAM_KEYWORDS),
+    CLI_ARG_INT("value", 0, UINT16_MAX),
+};
+
+static constexpr cli_arg_spec_t snapSig[] = {
+    CLI_ARG_KEYWORD("format", SNAP_FORMAT_KEYWORDS),
+};
+
+static constexpr cli_arg_spec_t writeSig[] = {
+    CLI_ARG_STRING("pin|mask"),
+    CLI_ARG_HEX("value", 0, 0xFFFFFFFF),
+    CLI_ARG_HEX("levels", 0, 0xFFFFFFFF),
+};
+
+static constexpr cli_arg_spec_t debugSig[] = {
+    CLI_ARG_KEYWORD("subcommand", DEBUG_SUBCMD_KEYWORDS),
+    CLI_ARG_KEYWORD("option", DEBUG_OPTION_KEYWORDS),
+};
+
+// signature length, and the arg count limit it allows: a trailing
+// ARG_REST spec takes all the remaining args
+template <size_t N>
+constexpr uint8_t cliSigCnt(const cli_arg_spec_t (&)[N]) { return N; }
+constexpr uint8_t cliSigCnt(decltype(nullptr)) { return 0; }
+
+template <size_t N>
+constexpr uint8_t cliSigMax(const cli_arg_spec_t (&sig)[N]) { return (sig[N - 1].type == ARG_REST) ? MAX_ARGS : N; }
+constexpr uint8_t cliSigMax(decltype(nullptr)) { return 0; }
+
+// CLI command registry
+// to add a command add a CLI_CMD() line here, nothing else needs updating
+// format is CLI_CMD("command", function, required arg count, signature, "help line 1", "help line 2")
+// NOTE: arguments past the required count are optional, the signature sets the maximum
 // NOTE: " " (space) on 2nd line of help doesn't display anything (for short helps)
-// NOTE: These are in alphabetical order for presentation (except help) FYI...
-cli_entry     cmdTable[CLI_COMMAND_CNT] = {
-    {"current",   curCmd,   0, "Read current for 12V and 3.3V rails.",           " "},
-    {"eeprom", eepromCmd,  -1, "Displays FRU EEPROM info areas if no args.",     "'eeprom <addr> <length>' dumps <length> bytes @ <addr>"},
-    {"pins",      pinCmd,   0, "Displays pin names and numbers.",                "NOTE: Xavier uses Arduino-style pin numbering."},
-	  {"power",     pwrCmd,  -1, "Control power to NIC 3.0 card.",                 "'power <up|down> <main|aux|card>' or 'power status' "},
-    {"read",     readCmd,   1, "Read input pin (Arduino numbering).",            "'read <pin_number>'"},
-    {"set",       setCmd,  -1, "Set EEPROM parameter to a value.",               "'set <param> <value>' sets value; or 'set' with no args for help."},
-    {"scan",     scanCmd,   0, "Scan chain query of NIC 3.0 card.",              " "},
-    {"status", statusCmd,   0, "Displays status of I/O pins etc.",               " "},
-    {"vers",     versCmd,   0, "Shows firmware version information.",            " "},
-    {"write",   writeCmd,   2, "Write output pin (Arduino numbering).",          "'write <pin_number> <0|1>'"},
-    {"xdebug",     debug,  -1, "Debug functions mostly for developer use.",      "Enter 'xdebug' with no arguments for more info."},
-    {"help",        help,   0, "NOTE: THIS DOES NOT DISPLAY ON PURPOSE",         " "},    
+// NOTE: Must be kept in strcmp() order, lookup is a binary search (checked at compile time)
+#define CLI_COMMANDS(CLI_CMD) \
+    CLI_CMD("capture", captureCmd, 0, captureSig, "Capture pin activity like a logic analyzer.", "'capture arm <hz> <pre> <post> [now|rise|fall|edge|pattern] [pin|mask] [value]', 'capture rle|vcd'") \
+    CLI_CMD("current",   curCmd, 0, CLI_NO_ARGS, "Read current for 12V and 3.3V rails.",        " ") \
+    CLI_CMD("eeprom", eepromCmd, 0, eepromSig,   "Displays FRU EEPROM info areas if no args.",  "'eeprom dump <offset> <length>' dumps <length> bytes @ <offset>") \
+    CLI_CMD("events", eventsCmd, 0, eventsSig,   "Show input pin edges caught by interrupt.",   "'events [show|clear|live]'; live shows them as they happen until a key is hit") \
+    CLI_CMD("help",        help, 0, CLI_NO_ARGS, "NOTE: THIS DOES NOT DISPLAY ON PURPOSE",      " ") \
+    CLI_CMD("mode",     modeCmd, 0, modeSig,     "Switch to the binary protocol or back.",      "'mode binary' or 'mode text'; see proto.hpp for the frame format") \
+    CLI_CMD("pins",      pinCmd, 0, CLI_NO_ARGS, "Displays pin names and numbers.",             "NOTE: Xavier uses Arduino-style pin numbering.") \
+    CLI_CMD("power",     pwrCmd, 0, pwrSig,      "Control power to NIC 3.0 card.",              "'power <up|down> <main|aux|card>' or 'power status' ") \
+    CLI_CMD("read",     readCmd, 1, readSig,     "Read input pin (Arduino numbering or name).", "'read <pin>'") \
+    CLI_CMD("repeat", repeatCmd, 2, repeatSig,   "Run a command <count> times, Ctrl-C stops.",  "'repeat <count> [interval_ms] <command...>'; use ';' to put several commands on a line") \
+    CLI_CMD("run",       runCmd, 1, runSig,      "Run a stored script, Ctrl-C stops.",          "'run <name>'; see 'script'") \
+    CLI_CMD("scan",     scanCmd, 0, CLI_NO_ARGS, "Scan chain query of NIC 3.0 card.",           " ") \
+    CLI_CMD("script", scriptCmd, 0, scriptSig,   "Manage stored scripts, lists them if no args.", "'script add <name> <command...>' appends a command; 'script del|auto <name>'") \
+    CLI_CMD("set",       setCmd, 0, setSig,      "Set EEPROM parameter to a value.",            "'set <param> <value>' sets value; or 'set' with no args for help.") \
+    CLI_CMD("snap",     snapCmd, 0, snapSig,     "One line telemetry snapshot (CSV or JSON).",  "'snap [csv|json|header]'; header gives the CSV column names") \
+    CLI_CMD("status", statusCmd, 0, CLI_NO_ARGS, "Displays status of I/O pins etc.",            " ") \
+    CLI_CMD("vers",     versCmd, 0, CLI_NO_ARGS, "Shows firmware version information.",         " ") \
+    CLI_CMD("write",   writeCmd, 2, writeSig,    "Write output pin (Arduino numbering or name).", "'write <pin> <0|1>' or 'write mask <pins hex> <levels hex>', bits in 'pins' order") \
+    CLI_CMD("xdebug",     debug, 0, debugSig,    "Debug functions mostly for developer use.",   "Enter 'xdebug' with no arguments for more info.")
+
+// command function prototypes, generated from the registry
+#define CLI_CMD_PROTO(name, func, args, sig, h1, h2)    int func(int);
+CLI_COMMANDS(CLI_CMD_PROTO)
+
+// CLI command table, generated from the registry
+#define CLI_CMD_ENTRY(name, func, args, sig, h1, h2)    {name, func, args, cliSigMax(sig), cliSigCnt(sig), sig, h1, h2},
+static constexpr cli_entry  cmdTable[] = {
+    CLI_COMMANDS(CLI_CMD_ENTRY)
 };
 
+#define CLI_COMMAND_CNT     (sizeof(cmdTable) / sizeof(cmdTable[0]))
+
+// lookup results other than a table index
+#define CLI_FIND_NONE       -1
+#define CLI_FIND_AMBIGUOUS  -2
+
+// compile time check that the registry is sorted and has no duplicates
+constexpr int cliStrCmp(const char *a, const char *b)
+{
+    return (*a != *b || *a == '\0') ? (*a - *b) : cliStrCmp(a + 1, b + 1);
+}
+
+constexpr bool cliTableSorted(unsigned i)
+{
+    return (i + 1 >= CLI_COMMAND_CNT) ? true :
+           (cliStrCmp(cmdTable[i].cmd, cmdTable[i + 1].cmd) < 0 &&
+            cliTableSorted(i + 1));
+}
+
+// and that no command requires more arguments than its signature has
+constexpr bool cliTableArgsOk(unsigned i)
+{
+    return (i >= CLI_COMMAND_CNT) ? true :
+           (cmdTable[i].minArgs <= cmdTable[i].maxArgs &&
+            cmdTable[i].maxArgs <= MAX_ARGS &&
+            cliTableArgsOk(i + 1));
+}
+
+static_assert(cliTableSorted(0), "CLI_COMMANDS() must be in strcmp() order with no duplicates");
+static_assert(cliTableArgsOk(0), "CLI_COMMANDS() required arg count exceeds its signature");
+static_assert(CLI_COMMAND_CNT <= PERF_CMD_MAX, "PERF_CMD_MAX must cover every CLI command");
+
 /**
   * @name   CURSOR
   * @brief  set terminal cursor
@@ -74,36 +224,31 @@ void CURSOR(uint8_t r,uint8_t c)
     char          bfr[12];
 
     sprintf(bfr, "\x1b[%d;%df", r, c);
-    SerialUSB.write(bfr);
-    SerialUSB.flush();
-    delay(5);
+    term_puts(bfr);
 }
 
 /**
   * @name   terminalOut
-  * @brief  wrapper to SerialUSB.print[ln]
+  * @brief  output a line to the terminal
   * @param  msg to output
   * @retval None
-  * @note   needed to address missing chars
+  * @note   queued to the TX ring, does not block
   */
 void terminalOut(char *msg)
 {
-    SerialUSB.println(msg);
-    SerialUSB.flush();
-    delay(50);
+    term_puts(msg);
+    term_write("\r\n", 2);
 }
 
 /**
   * @name   displayLine
-  * @brief  wrapper to SerialUSB.write
-  * @param  None
+  * @brief  output text to the terminal without a line ending
+  * @param  m text to output
   * @retval None
   */
 void displayLine(char *m)
 {
-    SerialUSB.write(m);
-    SerialUSB.flush();
-    delay(10);
+    term_puts(m);
 }
 
 /**
@@ -114,11 +259,8 @@ void displayLine(char *m)
   */
 void doPrompt(void)
 {
-    SerialUSB.write(0x0a);
-    SerialUSB.write(0x0d);
-    SerialUSB.flush();
-    SerialUSB.print(cliPrompt);
-    SerialUSB.flush();
+    term_write("\n\r", 2);
+    term_puts(cliPrompt);
 }
 
 /**
@@ -144,40 +286,337 @@ int waitAnyKey(void)
 {
     int             charIn;
 
-    while ( SerialUSB.available() == 0 )
+    term_flush();
+
+    while ( (charIn = term_getc()) < 0 )
       ;
 
-    charIn = SerialUSB.read();
     return(charIn);
 }
 
 /**
-  * @name   cli
-  * @brief  command line interpreter
-  * @param  raw = raw input line from terminal
+  * @name   cliFind
+  * @brief  look up a command by name or unique abbreviation
+  * @param  name command token
+  * @retval index into cmdTable[], CLI_FIND_NONE or CLI_FIND_AMBIGUOUS
+  * @note   binary search for the first entry >= name; since the table
+  *         is sorted all entries starting with name follow it
+  */
+static int cliFind(const char *name)
+{
+    int         lo = 0;
+    int         hi = CLI_COMMAND_CNT;
+    int         mid;
+    size_t      len = strlen(name);
+
+    while ( lo < hi )
+    {
+        mid = (lo + hi) / 2;
+        if ( strcmp(cmdTable[mid].cmd, name) < 0 )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if ( lo >= (int) CLI_COMMAND_CNT || strncmp(cmdTable[lo].cmd, name, len) != 0 )
+        return(CLI_FIND_NONE);
+
+    // exact match wins even if it is also a prefix of other commands
+    if ( cmdTable[lo].cmd[len] == '\0' )
+        return(lo);
+
+    if ( lo + 1 < (int) CLI_COMMAND_CNT && strncmp(cmdTable[lo + 1].cmd, name, len) == 0 )
+        return(CLI_FIND_AMBIGUOUS);
+
+    return(lo);
+}
+
+/**
+  * @name   cliShowAmbiguous
+  * @brief  list the commands an ambiguous abbreviation could mean
+  * @param  name command token
   * @retval None
   */
-bool cli(char *raw)
+static void cliShowAmbiguous(const char *name)
+{
+    size_t      len = strlen(name);
+    char        *t;
+
+    t = outBfr + sprintf(outBfr, "Ambiguous command '%s', could be:", name);
+
+    for ( int i = 0; i < (int) CLI_COMMAND_CNT; i++ )
+    {
+        if ( strncmp(cmdTable[i].cmd, name, len) == 0 && strcmp(cmdTable[i].cmd, "help") != 0 )
+            t += sprintf(t, " %s", cmdTable[i].cmd);
+    }
+
+    terminalOut(outBfr);
+}
+
+/**
+  * @name   cliShowUsage
+  * @brief  show command usage generated from its signature
+  * @param  entry command table entry
+  * @retval None
+  * @note   required args are shown as <arg>, optional ones as [arg]
+  */
+static void cliShowUsage(const cli_entry *entry)
+{
+    char        *t = fmt_str(fmt_str(outBfr, "Usage: "), entry->cmd);
+
+    for ( int i = 0; i < entry->sigCnt; i++ )
+    {
+        const cli_arg_spec_t    *spec = &entry->sig[i];
+
+        t = fmt_str(t, (i < entry->minArgs) ? " <" : " [");
+        t = fmt_str(t, (spec->type == ARG_KEYWORD) ? spec->keywords : spec->name);
+        t = fmt_str(t, (spec->type == ARG_REST) ? "...>" : (i < entry->minArgs) ? ">" : "]");
+    }
+
+    terminalOut(outBfr);
+}
+
+/**
+  * @name   cliParseKeyword
+  * @brief  find a token in a '|' separated keyword list
+  * @param  list keyword list
+  * @param  token text to find
+  * @retval index of the keyword in the list, -1 if not found
+  */
+static int cliParseKeyword(const char *list, const char *token)
+{
+    size_t      len = strlen(token);
+    int         ndx = 0;
+
+    while ( *list )
+    {
+        if ( strncmp(list, token, len) == 0 && (list[len] == '|' || list[len] == '\0') )
+            return(ndx);
+
+        while ( *list && *list != '|' )
+            list++;
+
+        if ( *list == '|' )
+            list++;
+
+        ndx++;
+    }
+
+    return(-1);
+}
+
+/**
+  * @name   cliParsePin
+  * @brief  parse a pin given by Arduino number or 'pins' name
+  * @param  token text to parse
+  * @retval Arduino pin number, -1 if it isn't a pin in staticPins[]
+  */
+int cliParsePin(const char *token)
+{
+    char        *end;
+    int         pinNo;
+
+    if ( isdigit(token[0]) )
+    {
+        pinNo = strtol(token, &end, 10);
+        if ( *end != '\0' )
+            return(-1);
+    }
+    else
+    {
+        pinNo = getPinByName(token);
+    }
+
+    return((getPinIndex(pinNo) < 0) ? -1 : pinNo);
+}
+
+/**
+  * @name   cliParseFixed
+  * @brief  parse a decimal number with up to 3 fraction digits
+  * @param  s text to parse
+  * @param  milli result in thousandths
+  * @retval true if the whole token parsed and fits
+  */
+static bool cliParseFixed(const char *s, int32_t *milli)
+{
+    bool        neg = false;
+    bool        digits = false;
+    int32_t     whole = 0;
+    int32_t     frac = 0;
+    int32_t     scale = 100;
+
+    if ( *s == '-' || *s == '+' )
+        neg = (*s++ == '-');
+
+    while ( isdigit(*s) )
+    {
+        whole = whole * 10 + (*s++ - '0');
+        digits = true;
+        if ( whole > INT32_MAX / 1000 - 1 )
+            return(false);
+    }
+
+    if ( *s == '.' )
+    {
+        s++;
+        while ( isdigit(*s) )
+        {
+            if ( scale == 0 )
+                return(false);
+
+            frac += (*s++ - '0') * scale;
+            scale /= 10;
+            digits = true;
+        }
+    }
+
+    if ( *s != '\0' || digits == false )
+        return(false);
+
+    *milli = whole * 1000 + frac;
+    if ( neg )
+        *milli = -*milli;
+
+    return(true);
+}
+
+/**
+  * @name   cliParseArgs
+  * @brief  parse and range check command arguments into cliArgs[]
+  * @param  entry command table entry
+  * @param  argCount number of arguments on the command line
+  * @retval true if all arguments are valid, else false
+  * @note   errors are reported here, followed by the command usage;
+  *         string values point into the tokenized input line
+  */
+static bool cliParseArgs(const cli_entry *entry, int argCount)
+{
+    const cli_arg_spec_t *spec;
+    cli_arg_t               *arg;
+    const char              *token;
+    const char              *err = NULL;
+    char                    *end;
+    char                    *t;
+    int                     i;
+
+    for ( i = 0; i < MAX_ARGS; i++ )
+        cliArgs[i].present = false;
+
+    for ( i = 0; i < argCount && err == NULL; i++ )
+    {
+        // a trailing ARG_REST spec covers all remaining args
+        spec = &entry->sig[(i < entry->sigCnt) ? i : entry->sigCnt - 1];
+        arg = &cliArgs[i];
+        token = tokens[i + 1];
+
+        switch ( spec->type )
+        {
+            case ARG_INT:
+                if ( token[0] == '0' && (token[1] == 'x' || token[1] == 'X') )
+                    arg->i = strtol(token, &end, 16);
+                else
+                    arg->i = strtol(token, &end, 10);
+
+                if ( *end != '\0' || end == token )
+                    err = "is not a valid integer";
+                else if ( arg->i < spec->min || arg->i > spec->max )
+                    err = "is out of range";
+                break;
+
+            case ARG_HEX:
+                arg->u = strtoul(token, &end, 16);
+                if ( *end != '\0' || end == token || token[0] == '-' )
+                    err = "is not a valid hex number";
+                else if ( arg->u < (uint32_t) spec->min || arg->u > (uint32_t) spec->max )
+                    err = "is out of range";
+                break;
+
+            case ARG_FIXED:
+                if ( cliParseFixed(token, &arg->i) == false )
+                    err = "is not a valid number";
+                else if ( arg->i < spec->min || arg->i > spec->max )
+                    err = "is out of range";
+                break;
+
+            case ARG_KEYWORD:
+                arg->i = cliParseKeyword(spec->keywords, token);
+                if ( arg->i < 0 )
+                    err = "is not a valid choice";
+                break;
+
+            case ARG_PIN:
+                arg->i = cliParsePin(token);
+                if ( arg->i < 0 )
+                    err = "is not a valid pin; use 'pins' command for help";
+                break;
+
+            case ARG_STRING:
+            case ARG_REST:
+            default:
+                arg->s = token;
+                break;
+        }
+
+        arg->present = true;
+    }
+
+    if ( err == NULL )
+        return(true);
+
+    // e.g. "value '7' is out of range 0..1"
+    t = fmt_str(outBfr, spec->name);
+    t = fmt_str(t, " '");
+    t = fmt_str(t, tokens[i]);
+    t = fmt_str(t, "' ");
+    t = fmt_str(t, err);
+
+    if ( spec->type == ARG_KEYWORD )
+    {
+        t = fmt_str(fmt_str(t, ", use "), spec->keywords);
+    }
+    else if ( spec->type == ARG_INT )
+    {
+        t = fmt_i32(fmt_str(t, " "), spec->min);
+        t = fmt_i32(fmt_str(t, ".."), spec->max);
+    }
+    else if ( spec->type == ARG_FIXED )
+    {
+        t = fmt_milli(fmt_str(t, " "), spec->min, 3, 0);
+        t = fmt_milli(fmt_str(t, ".."), spec->max, 3, 0);
+    }
+    else if ( spec->type == ARG_HEX )
+    {
+        t = fmt_hex(fmt_str(t, " 0x"), spec->min, 8);
+        t = fmt_hex(fmt_str(t, "..0x"), spec->max, 8);
+    }
+
+    terminalOut(outBfr);
+    cliShowUsage(entry);
+    return(false);
+}
+
+/**
+  * @name   cliParseLine
+  * @brief  tokenize and parse a single command
+  * @param  input = command line, tokenized in place
+  * @param  entry = set to the command table entry found
+  * @param  argCount = set to the number of arguments
+  * @retval CLI_ERR_xxx, CLI_ERR_EMPTY for a blank line
+  * @note   errors are reported here; on success tokens[] and
+  *         cliArgs[] are ready for the command function
+  */
+static int cliParseLine(char *input, const cli_entry **entry, int *argCount)
 {
-    bool         rc = false;
-    int         len;
+    int         cmdNdx;
     char        *token;
     const char  delim[] = " ";
     int         tokNdx = 0;
-    char        input[80];
-    int         error = CLI_ERR_CMD_NOT_FOUND;
-    int         argCount;
-
-    strcpy(input, (char *) raw);
-    len = strlen(input);
+    int         error = CLI_ERR_NO_ERROR;
 
     // initial call, should get and save the command as 0th token
     token = strtok(input, delim);
     if ( token == NULL )
-    {
-      doPrompt();
-      return(true);
-    }
+      return(CLI_ERR_EMPTY);
 
     tokens[tokNdx++] = token;
 
@@ -192,58 +631,674 @@ bool cli(char *raw)
     if ( tokNdx >= MAX_TOKENS )
     {
         terminalOut((char *) "Too many arguments in command line!");
-        doPrompt();
-        return(false);
+        return(CLI_ERR_TOO_MANY_ARGS);
     }
 
     // adjust arg count to not include the command itself (token[0]
-    argCount = tokNdx - 1;
+    *argCount = tokNdx - 1;
 
-    for ( int i = 0; i < (int) CLI_COMMAND_CNT; i++ )
+    cmdNdx = cliFind(tokens[0]);
+
+    if ( cmdNdx == CLI_FIND_AMBIGUOUS )
+    {
+        cliShowAmbiguous(tokens[0]);
+        return(CLI_ERR_AMBIGUOUS);
+    }
+    else if ( cmdNdx == CLI_FIND_NONE )
+    {
+        terminalOut((char *) "Invalid command");
+        return(CLI_ERR_CMD_NOT_FOUND);
+    }
+
+    *entry = &cmdTable[cmdNdx];
+
+    if ( *argCount < (*entry)->minArgs )
+    {
+        terminalOut((char *) "Not enough arguments for this command, check help.");
+        error = CLI_ERR_TOO_FEW_ARGS;
+    }
+    else if ( *argCount > (*entry)->maxArgs )
     {
-        if ( strncmp(tokens[0], cmdTable[i].cmd, len) == 0 )
+        terminalOut((char *) "Too many arguments for this command, check help.");
+        error = CLI_ERR_TOO_MANY_ARGS;
+    }
+    else if ( cliParseArgs(*entry, *argCount) == false )
+    {
+        // already reported by cliParseArgs()
+        return(CLI_ERR_BAD_ARG);
+    }
+
+    if ( error != CLI_ERR_NO_ERROR )
+        cliShowUsage(*entry);
+
+    return(error);
+}
+
+/**
+  * @name   cliJobStep
+  * @brief  run one step of the current job
+  * @param  cancel = true to stop it
+  * @retval None
+  * @note   the job's final status becomes the command status
+  */
+static void cliJobStep(bool cancel)
+{
+    int                 rc;
+
+    rc = (cliJob) (cancel);
+    if ( rc != CLI_JOB_RUNNING || cancel )
+    {
+        cliJob = NULL;
+        cliStatus = (rc == CLI_JOB_RUNNING) ? 1 : rc;
+    }
+}
+
+/**
+  * @name   cliDispatch
+  * @brief  run a parsed command and record its status and timing
+  * @param  entry = command to run, args are in cliArgs[]
+  * @param  argCount = number of args
+  * @retval None
+  * @note   a command's time covers any job it starts, through to the
+  *         job's end; for a background job that is recorded by
+  *         cliJobService()
+  * @note   a job's step may run commands (e.g. repeat), so the job
+  *         being stepped is set aside while they run and their own
+  *         jobs are finished inline
+  */
+static void cliDispatch(const cli_entry *entry, int argCount)
+{
+    uint32_t            bytes = term_outCount();
+    uint32_t            start = micros();
+    bool                detach = cliDetach && cliDepth == 0;
+    cli_job_t           outer = cliJob;
+
+    cliDepth++;
+    cliJob = NULL;
+
+    // loop() isn't running background tasks under a list, repeat or
+    // script, so give them a turn before each command
+    serviceBackground();
+
+    // command funcs are passed arg count, parsed args are in cliArgs[]
+    cliStatus = (entry->func) (argCount);
+
+    // a job started by a nested, listed or protocol command has to
+    // finish before whatever follows it runs; only Ctrl-C stops it,
+    // other input (e.g. pipelined protocol frames) is left queued
+    if ( detach == false )
+    {
+        while ( cliJob != NULL )
         {
-            if ( (cmdTable[i].argCount == argCount) || (cmdTable[i].argCount == -1) )
-            {
-                // command funcs are passed arg count, tokens are global
-                (cmdTable[i].func) (argCount);
-                SerialUSB.flush();
-                rc = true;
-                error = CLI_ERR_NO_ERROR;
+            cliJobStep(term_break());
+            serviceBackground();
+        }
+    }
+
+    cliDepth--;
+
+    if ( cliJob != NULL )
+    {
+        cliJobCmd = entry - cmdTable;
+        cliJobStartUs = start;
+        cliJobBytes = bytes;
+        return;
+    }
+
+    cliJob = outer;
+    perf_cmdRecord(entry - cmdTable, start, term_outCount() - bytes);
+}
+
+/**
+  * @name   cliExec
+  * @brief  tokenize, parse and run a single command
+  * @param  cmdLine = one command and its arguments
+  * @retval true if the command was run (or the line was empty)
+  * @note   may be called recursively, e.g. by 'repeat'; tokens[] and
+  *         cliArgs[] belong to the innermost call while it runs
+  */
+static bool cliExec(const char *cmdLine)
+{
+    char                input[MAX_LINE_SZ];
+    const cli_entry     *entry;
+    int                 argCount;
+    int                 error;
+
+    strncpy(input, cmdLine, sizeof(input) - 1);
+    input[sizeof(input) - 1] = 0;
+
+    error = cliParseLine(input, &entry, &argCount);
+    if ( error == CLI_ERR_EMPTY )
+    {
+        return(true);
+    }
+    else if ( error != CLI_ERR_NO_ERROR )
+    {
+        cliStatus = -1;
+        return(false);
+    }
+
+    cliDispatch(entry, argCount);
+    return(true);
+
+} // cliExec()
+
+/**
+  * @name   cliCodeArgLen
+  * @brief  bytecode size of one argument
+  * @param  type = argument type from the signature
+  * @param  s = argument text, for string types
+  * @retval bytes
+  */
+static int cliCodeArgLen(cli_arg_type_t type, const char *s)
+{
+    if ( type == ARG_KEYWORD || type == ARG_PIN )
+        return(1);
+    else if ( type == ARG_INT || type == ARG_HEX || type == ARG_FIXED )
+        return(4);
+
+    return(strlen(s) + 1);
+}
+
+/**
+  * @name   cliCompile
+  * @brief  parse a command once into compact bytecode
+  * @param  cmdLine = one command and its arguments
+  * @param  code = where to append the bytecode
+  * @param  size = space available at code
+  * @retval bytes of bytecode written, 0 for a blank line, -1 on error
+  * @note   encoding is [command index][arg count] then per arg, as
+  *         given by the command signature: keyword and pin 1 byte;
+  *         int, hex and fixed 4 bytes little endian; strings NUL
+  *         terminated. Only valid for the firmware that wrote it,
+  *         see cliRegistryId().
+  */
+int cliCompile(const char *cmdLine, uint8_t *code, int size)
+{
+    char                    input[MAX_LINE_SZ];
+    const cli_entry         *entry;
+    const cli_arg_spec_t *spec;
+    uint8_t                 *p = code;
+    int                     argCount;
+    int                     error;
+    int                     len;
+
+    strncpy(input, cmdLine, sizeof(input) - 1);
+    input[sizeof(input) - 1] = 0;
+
+    error = cliParseLine(input, &entry, &argCount);
+    if ( error == CLI_ERR_EMPTY )
+        return(0);
+    else if ( error != CLI_ERR_NO_ERROR )
+        return(-1);
+
+    size -= 2;
+    for ( int i = 0; i < argCount; i++ )
+    {
+        spec = &entry->sig[(i < entry->sigCnt) ? i : entry->sigCnt - 1];
+        size -= cliCodeArgLen(spec->type, cliArgs[i].s);
+    }
+
+    if ( size < 0 )
+    {
+        terminalOut((char *) "Not enough space for command");
+        return(-1);
+    }
+
+    *p++ = entry - cmdTable;
+    *p++ = argCount;
+
+    for ( int i = 0; i < argCount; i++ )
+    {
+        spec = &entry->sig[(i < entry->sigCnt) ? i : entry->sigCnt - 1];
+
+        switch ( spec->type )
+        {
+            case ARG_KEYWORD:
+            case ARG_PIN:
+                *p++ = cliArgs[i].i;
                 break;
-            }
-            else if ( cmdTable[i].argCount > argCount )
-            {
-                error = CLI_ERR_TOO_FEW_ARGS;
-                rc = false;
+
+            case ARG_INT:
+            case ARG_HEX:
+            case ARG_FIXED:
+                for ( int b = 0; b < 32; b += 8 )
+                    *p++ = cliArgs[i].u >> b;
                 break;
-            }
-            else
-            {
-                error = CLI_ERR_TOO_MANY_ARGS;
-                rc = false;
+
+            case ARG_STRING:
+            case ARG_REST:
+            default:
+                len = strlen(cliArgs[i].s) + 1;
+                memcpy(p, cliArgs[i].s, len);
+                p += len;
                 break;
+        }
+    }
+
+    return(p - code);
+}
+
+/**
+  * @name   cliRunCode
+  * @brief  run bytecode from cliCompile()
+  * @param  code = bytecode for one or more commands
+  * @param  len = bytes of bytecode
+  * @retval true if all commands ran, false if bad code or stopped
+  * @note   string args point into code, which must stay valid while
+  *         it runs; Ctrl-C between commands stops
+  */
+bool cliRunCode(const uint8_t *code, int len)
+{
+    static int              depth = 0;
+    const uint8_t           *end = code + len;
+    const cli_entry         *entry;
+    const cli_arg_spec_t *spec;
+    int                     argCount;
+    bool                    rc = true;
+
+    // scripts can run scripts, don't let them do it forever
+    if ( depth >= CLI_RUN_DEPTH_MAX )
+    {
+        terminalOut((char *) "Scripts nested too deeply");
+        return(false);
+    }
+
+    depth++;
+
+    while ( code < end && rc == true )
+    {
+        if ( term_break() || end - code < 2 || code[0] >= CLI_COMMAND_CNT || code[1] > MAX_ARGS )
+        {
+            rc = false;
+            break;
+        }
+
+        entry = &cmdTable[*code++];
+        argCount = *code++;
+        tokens[0] = (char *) entry->cmd;
+
+        for ( int i = 0; i < argCount && rc == true; i++ )
+        {
+            spec = &entry->sig[(i < entry->sigCnt) ? i : entry->sigCnt - 1];
+            cliArgs[i].present = true;
+            tokens[i + 1] = (char *) "";
+
+            switch ( spec->type )
+            {
+                case ARG_KEYWORD:
+                case ARG_PIN:
+                    cliArgs[i].i = *code++;
+                    break;
+
+                case ARG_INT:
+                case ARG_HEX:
+                case ARG_FIXED:
+                    cliArgs[i].u = 0;
+                    for ( int b = 0; b < 32; b += 8 )
+                        cliArgs[i].u |= (uint32_t) *code++ << b;
+                    break;
+
+                case ARG_STRING:
+                case ARG_REST:
+                default:
+                    cliArgs[i].s = tokens[i + 1] = (char *) code;
+                    code += strlen((const char *) code) + 1;
+                    break;
             }
+
+            if ( code > end )
+                rc = false;
         }
+
+        for ( int i = argCount; i < MAX_ARGS; i++ )
+            cliArgs[i].present = false;
+
+        if ( rc == true )
+            cliDispatch(entry, argCount);
     }
 
+    depth--;
+
     if ( rc == false )
     {
-        if ( error == CLI_ERR_CMD_NOT_FOUND )
-         terminalOut((char *) "Invalid command");
-        else if ( error == CLI_ERR_TOO_FEW_ARGS )
-          terminalOut((char *) "Not enough arguments for this command, check help.");
-        else if ( error == CLI_ERR_TOO_MANY_ARGS )
-          terminalOut((char *) "Too many arguments for this command, check help.");
-        else
-          terminalOut((char *) "Unknown parser s/w error");
+        cliStatus = -1;
+        terminalOut((char *) "Script stopped");
     }
 
-    doPrompt();
+    return(rc);
+}
+
+/**
+  * @name   cliHash
+  * @brief  add a string to an FNV-1a hash
+  * @param  hash = hash so far
+  * @param  s = string, its NUL is hashed too so lists can't run together
+  * @retval new hash
+  */
+static uint32_t cliHash(uint32_t hash, const char *s)
+{
+    do
+    {
+        hash = (hash ^ (uint8_t) *s) * 16777619u;
+    } while ( *s++ );
+
+    return(hash);
+}
+
+/**
+  * @name   cliRegistryId
+  * @brief  identify the command registry that bytecode was built for
+  * @param  None
+  * @retval hash of the command names and argument specs
+  * @note   stored with saved bytecode; a firmware update that changes
+  *         the registry changes this and invalidates the old code
+  * @note   keyword lists are included since bytecode holds keyword
+  *         indexes, and the limits since they were checked at compile
+  */
+uint32_t cliRegistryId(void)
+{
+    uint32_t        hash = 2166136261u;      // FNV-1a
+    const cli_arg_spec_t *spec;
+
+    for ( int i = 0; i < (int) CLI_COMMAND_CNT; i++ )
+    {
+        hash = cliHash(hash, cmdTable[i].cmd);
+
+        for ( int j = 0; j < cmdTable[i].sigCnt; j++ )
+        {
+            spec = &cmdTable[i].sig[j];
+            hash = (hash ^ spec->type) * 16777619u;
+            hash = (hash ^ (uint32_t) spec->min) * 16777619u;
+            hash = (hash ^ (uint32_t) spec->max) * 16777619u;
+
+            if ( spec->keywords != nullptr )
+                hash = cliHash(hash, spec->keywords);
+        }
+    }
+
+    return(hash);
+}
+
+/**
+  * @name   cliCommandName
+  * @brief  name of a command by registry index
+  * @param  index = command table index
+  * @retval command name, NULL past the end of the table
+  */
+const char *cliCommandName(int index)
+{
+    if ( index < 0 || index >= (int) CLI_COMMAND_CNT )
+        return(NULL);
+
+    return(cmdTable[index].cmd);
+}
+
+/**
+  * @name   cliLine
+  * @brief  run a line of one or more commands
+  * @param  raw = command line
+  * @retval true if all commands were run
+  * @note   ';' separates commands on one line; they run in order and
+  *         the rest of the line is skipped after a CLI error
+  */
+bool cliLine(const char *raw)
+{
+    char        line[MAX_LINE_SZ];
+    char        *cmd = line;
+    char        *next;
+    bool        rc;
+
+    strncpy(line, raw, sizeof(line) - 1);
+    line[sizeof(line) - 1] = 0;
+
+    do
+    {
+        next = strchr(cmd, ';');
+        if ( next != NULL )
+            *next++ = 0;
+
+        // only the last command typed at the prompt may leave a job
+        // running in the background
+        cliDetach = cliInteractive && next == NULL;
+
+        rc = cliExec(cmd);
+        cmd = next;
+
+    } while ( cmd != NULL && rc == true );
+
+    cliDetach = false;
+    return(rc);
+}
+
+/**
+  * @name   cli
+  * @brief  command line interpreter
+  * @param  raw = raw input line from terminal
+  * @retval true if all commands were run
+  */
+bool cli(char *raw)
+{
+    bool        rc;
+
+    cliInteractive = true;
+    rc = cliLine(raw);
+    cliInteractive = false;
+
+    // a background job prompts when it finishes
+    if ( cliJob == NULL )
+        doPrompt();
+
     return(rc);
 
 } // cli()
 
+/**
+  * @name   cliJobStart
+  * @brief  continue a long running command as a job
+  * @param  job = step function, called until it is done
+  * @retval 0, for the command to return
+  * @note   typed at the prompt, the command returns and the job is
+  *         stepped from loop() so the heartbeat, input and background
+  *         work keep going, and any key cancels it; anywhere else
+  *         (lists, repeat, scripts, protocol) it is run to completion
+  *         before the next command and only Ctrl-C cancels it, see
+  *         cliJobDetached()
+  */
+int cliJobStart(cli_job_t job)
+{
+    cliJob = job;
+    return(0);
+}
+
+/**
+  * @name   cliJobDetached
+  * @brief  check if a job started now would run in the background
+  * @param  None
+  * @retval true for the last command typed at the prompt, false in
+  *         lists, repeat, scripts and protocol requests
+  * @note   jobs that only end on a keypress should refuse to start,
+  *         or do a single pass, when this is false
+  */
+bool cliJobDetached(void)
+{
+    return(cliDetach && cliDepth == 1);
+}
+
+/**
+  * @name   cliCommandRunning
+  * @brief  check if a command is being run
+  * @param  None
+  * @retval true inside a command, including a job run inline
+  */
+bool cliCommandRunning(void)
+{
+    return(cliDepth > 0);
+}
+
+/**
+  * @name   cliJobActive
+  * @brief  check for a background job
+  * @param  None
+  * @retval true if a job is running
+  */
+bool cliJobActive(void)
+{
+    return(cliJob != NULL);
+}
+
+/**
+  * @name   cliJobService
+  * @brief  step the background job, any key cancels it
+  * @param  None
+  * @retval true if a job owns the input, else false
+  * @note   called from loop() ahead of input processing
+  */
+bool cliJobService(void)
+{
+    bool        cancel;
+
+    if ( cliJob == NULL )
+        return(false);
+
+    // the key that cancels isn't meant as input
+    cancel = term_getc() >= 0;
+    if ( cancel )
+        term_rxFlush();
+
+    cliJobStep(cancel);
+
+    if ( cliJob == NULL )
+    {
+        // the job's command is timed from launch to here
+        if ( cliJobCmd >= 0 )
+        {
+            perf_cmdRecord(cliJobCmd, cliJobStartUs, term_outCount() - cliJobBytes);
+            cliJobCmd = -1;
+        }
+        doPrompt();
+    }
+
+    return(true);
+}
+
+/**
+  * @name   cliLastStatus
+  * @brief  result of the last command run
+  * @param  None
+  * @retval command function return value, -1 if the CLI rejected it
+  */
+int cliLastStatus(void)
+{
+    return(cliStatus);
+}
+
+/**
+  * @name   repeatStep
+  * @brief  repeat job, runs the command each time it is due
+  * @param  cancel = true to stop
+  * @retval CLI_JOB_RUNNING, 0 when all runs are done, 1 on error or
+  *         when stopped
+  */
+static int repeatStep(bool cancel)
+{
+    char        *t;
+
+    if ( cancel )
+    {
+        terminalOut((char *) "repeat stopped");
+        repeatBusy = false;
+        return(1);
+    }
+
+    // each run is due one interval after the previous one was due,
+    // so command run time doesn't add drift
+    if ( (int32_t) (millis() - repeatDue) < 0 )
+        return(CLI_JOB_RUNNING);
+
+    t = fmt_str(outBfr, "#");
+    t = fmt_i32(t, repeatN);
+    t = fmt_str(t, " ");
+    fmt_u32(t, millis() - repeatStart);
+    terminalOut(outBfr);
+
+    repeatDue += repeatInterval;
+
+    if ( cliExec(repeatLine) == false )
+    {
+        repeatBusy = false;
+        return(1);
+    }
+
+    if ( ++repeatN > repeatCount )
+    {
+        repeatBusy = false;
+        return(0);
+    }
+
+    return(CLI_JOB_RUNNING);
+}
+
+/**
+  * @name   repeatCmd
+  * @brief  run a command a number of times on the board
+  * @param  cliArgs[0] = repeat count
+  * @param  cliArgs[1..] = optional interval in msec, then the command
+  * @retval 0=OK 1=error or stopped
+  * @note   each run's output is preceded by a '#<n> <msec>' record line
+  *         so a host can split the stream
+  * @note   the runs are made by repeatStep() as a job, so at the prompt
+  *         any key stops it; in lists, scripts and protocol requests
+  *         Ctrl-C does
+  */
+int repeatCmd(int argCnt)
+{
+    char        *t = repeatLine;
+    int         first = 1;
+    char        *end;
+
+    // there's one set of repeat state, see repeatStep()
+    if ( repeatBusy )
+    {
+        terminalOut((char *) "repeat can't be nested");
+        return(1);
+    }
+
+    repeatInterval = 0;
+
+    // an all-digit first word is the interval, the command follows it
+    if ( isdigit(cliArgs[1].s[0]) )
+    {
+        repeatInterval = strtoul(cliArgs[1].s, &end, 10);
+        if ( *end != 0 || argCnt < 3 || repeatInterval > REPEAT_INTERVAL_MAX )
+        {
+            sprintf(outBfr, "Usage: repeat <count> [interval_ms] <command...>, interval <= %lu",
+                    (unsigned long) REPEAT_INTERVAL_MAX);
+            SHOW();
+            return(1);
+        }
+        first = 2;
+    }
+
+    // rebuild the command line, tokens[] is reused by each run
+    *t = 0;
+    for ( int i = first; i < argCnt; i++ )
+    {
+        if ( t != repeatLine )
+            t = fmt_str(t, " ");
+        t = fmt_str(t, cliArgs[i].s);
+    }
+
+    repeatCount = cliArgs[0].i;
+    repeatN = 1;
+    repeatStart = millis();
+    repeatDue = repeatStart;
+    repeatBusy = true;
+
+    return(cliJobStart(repeatStep));
+
+} // repeatCmd()
+
 /**
   * @name   help
   * @brief  CLI help feature
@@ -285,19 +1340,15 @@ int help(int arg)
   */
 void showCommandHelp(char *cmd)
 {
-    for ( int i = 0; i < (int) CLI_COMMAND_CNT; i++ )
-    {
-      if ( strcmp(cmdTable[i].cmd, "help") == 0 )
-        continue;
+    int         i = cliFind(cmd);
 
-      if ( strcmp(cmd, cmdTable[i].cmd) == 0 )
-      {
-        terminalOut(cmdTable[i].help1);
+    if ( i < 0 || strcmp(cmdTable[i].cmd, "help") == 0 )
+      return;
 
-        if ( cmdTable[i].help2[0] != ' ' )
-        {
-          terminalOut(cmdTable[i].help2);
-        }          
-      }
+    terminalOut((char *) cmdTable[i].help1);
+
+    if ( cmdTable[i].help2[0] != ' ' )
+    {
+      terminalOut((char *) cmdTable[i].help2);
     }
 }
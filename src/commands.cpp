@@ -12,8 +12,10 @@
 #include "eeprom.hpp"
 #include <math.h>
 #include "commands.hpp"
+#include "fmt.hpp"
+#include "perf.hpp"
+#include "presence.hpp"
 
-extern char                 *tokens[];
 extern EEPROM_data_t        EEPROMData;
 extern volatile uint32_t    scanClockPulseCounter;
 extern volatile bool        enableScanClk;
@@ -26,7 +28,7 @@ extern volatile uint32_t    scanShiftRegister_0;
 // written, there would be a dead short on that pin (no resistors).
 // NOTE: The order of the entries in this table is the order they are displayed by the
 // 'pins' command. There is no other signficance to the order.
- const pin_mgt_t     staticPins[] = {
+ constexpr pin_mgt_t staticPins[] = {
   {           OCP_SCAN_LD_N, OUTPUT_PIN,  ACT_LO, "OCP_SCAN_LD_N"},
   {            OCP_SCAN_CLK, OUTPUT_PIN,  ACT_LO, "OCP_SCAN_CLK"},
   {         OCP_MAIN_PWR_EN, OUTPUT_PIN,  ACT_HI, "OCP_MAIN_PWR_EN"},
@@ -56,7 +58,96 @@ extern volatile uint32_t    scanShiftRegister_0;
   {               TEMP_CRIT, INPUT_PIN,   ACT_HI, "TEMP_CRIT"},
 };
 
-uint16_t      static_pin_count = sizeof(staticPins) / sizeof(pin_mgt_t);
+#define STATIC_PIN_CNT      (sizeof(staticPins) / sizeof(pin_mgt_t))
+
+uint16_t      static_pin_count = STATIC_PIN_CNT;
+
+// compile time search of staticPins[], -1 if pinNo has no entry
+constexpr int8_t pinIndexOf(int pinNo, unsigned i = 0)
+{
+    return (i >= STATIC_PIN_CNT) ? -1 :
+           (staticPins[i].pinNo == pinNo) ? (int8_t) i : pinIndexOf(pinNo, i + 1);
+}
+
+// true if every entry is a valid pin number that appears only once
+constexpr bool pinTableOk(unsigned i = 0)
+{
+    return (i >= STATIC_PIN_CNT) ? true :
+           (staticPins[i].pinNo < PINS_COUNT && pinIndexOf(staticPins[i].pinNo) == (int) i) && pinTableOk(i + 1);
+}
+
+static_assert(pinTableOk(), "staticPins[] has a duplicate or out of range pin number");
+
+// Arduino pin number -> staticPins[] index, -1 for pins not in the table
+#define PIN_MAP4(n)         pinIndexOf(n), pinIndexOf(n + 1), pinIndexOf(n + 2), pinIndexOf(n + 3)
+
+static constexpr int8_t     pinIndexMap[] = {
+    PIN_MAP4(0),  PIN_MAP4(4),  PIN_MAP4(8),  PIN_MAP4(12), PIN_MAP4(16),
+    PIN_MAP4(20), PIN_MAP4(24), PIN_MAP4(28), PIN_MAP4(32),
+};
+
+static_assert(sizeof(pinIndexMap) == PINS_COUNT, "pinIndexMap[] must cover PINS_COUNT pins");
+
+// every board signal in main.hpp needs a staticPins[] entry; not here
+// are UART_TX_UNUSED, the I2C pins, LED and USB, and the unused LFF pins
+#define PIN_HAS_ENTRY(pin)  static_assert(pinIndexOf(pin) >= 0, #pin " has no staticPins[] entry")
+
+PIN_HAS_ENTRY(OCP_SCAN_LD_N);
+PIN_HAS_ENTRY(OCP_MAIN_PWR_EN);
+PIN_HAS_ENTRY(OCP_SCAN_DATA_IN);
+PIN_HAS_ENTRY(OCP_SCAN_CLK);
+PIN_HAS_ENTRY(OCP_PRSNTB1_N);
+PIN_HAS_ENTRY(PCIE_PRES_N);
+PIN_HAS_ENTRY(SCAN_VER_0);
+PIN_HAS_ENTRY(OCP_SCAN_DATA_OUT);
+PIN_HAS_ENTRY(OCP_AUX_PWR_EN);
+PIN_HAS_ENTRY(NIC_PWR_GOOD);
+PIN_HAS_ENTRY(OCP_PWRBRK_N);
+PIN_HAS_ENTRY(OCP_BIF0_N);
+PIN_HAS_ENTRY(OCP_PRSNTB3_N);
+PIN_HAS_ENTRY(FAN_ON_AUX);
+PIN_HAS_ENTRY(OCP_SMB_RST_N);
+PIN_HAS_ENTRY(OCP_PRSNTB0_N);
+PIN_HAS_ENTRY(OCP_BIF1_N);
+PIN_HAS_ENTRY(OCP_SLOT_ID0);
+PIN_HAS_ENTRY(OCP_SLOT_ID1);
+PIN_HAS_ENTRY(OCP_PRSNTB2_N);
+PIN_HAS_ENTRY(SCAN_VER_1);
+PIN_HAS_ENTRY(PHY_RESET_N);
+PIN_HAS_ENTRY(RBT_ISOLATE_EN);
+PIN_HAS_ENTRY(OCP_BIF2_N);
+PIN_HAS_ENTRY(OCP_WAKE_N);
+PIN_HAS_ENTRY(TEMP_WARN);
+PIN_HAS_ENTRY(TEMP_CRIT);
+
+// PORT group and bit for each staticPins[] entry, filled in from the
+// variant's g_APinDescription[] by configureIOPins() so readAllPins()
+// can sample both PORT IN registers once and pick the bits out
+typedef struct {
+    uint8_t     port;
+    uint32_t    mask;
+} pin_port_t;
+
+static pin_port_t   pinPorts[STATIC_PIN_CNT];
+
+// pin bitmaps (bit n = staticPins[n]) are 32 bits wide
+static_assert(STATIC_PIN_CNT <= 32, "pin bitmaps need more than 32 bits");
+
+#define PIN_BIT(pin)        (1UL << pinIndexOf(pin))
+
+// pin_group_t members as pin bitmaps, list order must match the enum
+static constexpr uint32_t   pinGroups[] = {
+    PIN_BIT(OCP_MAIN_PWR_EN) | PIN_BIT(OCP_AUX_PWR_EN),
+    PIN_BIT(OCP_SCAN_LD_N) | PIN_BIT(OCP_SCAN_CLK),
+    PIN_BIT(OCP_MAIN_PWR_EN) | PIN_BIT(OCP_AUX_PWR_EN) | PIN_BIT(PHY_RESET_N),
+};
+
+static_assert(sizeof(pinGroups) / sizeof(pinGroups[0]) == PIN_GROUP_CNT, "pinGroups[] must match pin_group_t");
+
+// pinGroups[] as PORTA/PORTB masks, and all the output pins, filled
+// in by configureIOPins()
+static uint32_t     pinGroupPorts[PIN_GROUP_CNT][2];
+static uint32_t     pinOutputs;
 
 typedef struct {
     uint8_t     bitNo;
@@ -119,6 +210,13 @@ const scan_data_t     scanBitNames[] = {
 #define U3_MAX_CURRENT  3.0       /* In our case this is enaugh even tho shunt is capable to 50 A*/
 #define SHUNT_R         0.01      /* Shunt resistor in ohms (R211 and R210 are the same ohms) */
 
+// Integer conversions of the INA219 registers so no float math or float printf
+// is needed.  calibrate() with the MAX_CURRENT values above picks a current LSB
+// of 100 uA; the bus voltage register is 4 mV/LSB in bits 15..3.
+#define INA219_CURRENT_LSB_uA       100
+#define INA219_CURRENT_mA(raw)      (((int32_t) (raw) * INA219_CURRENT_LSB_uA) / 1000)
+#define INA219_BUS_mV(raw)          ((int32_t) ((raw) >> 3) * 4)
+
 #define STATUS_DISPLAY_DELAY_ms     3000
 
 static char             outBfr[OUTBFR_SIZE];
@@ -145,10 +243,21 @@ void configureIOPins(void)
   for ( int i = 0; i < static_pin_count; i++ )
   {
       pinNo = staticPins[i].pinNo;
+      pinPorts[i].port = g_APinDescription[pinNo].ulPort;
+      pinPorts[i].mask = 1UL << g_APinDescription[pinNo].ulPin;
+
+      for ( int g = 0; g < PIN_GROUP_CNT; g++ )
+      {
+          if ( pinGroups[g] & (1UL << i) )
+              pinGroupPorts[g][pinPorts[i].port] |= pinPorts[i].mask;
+      }
+
       pinMode(pinNo, staticPins[i].pinFunc);
 
       if ( staticPins[i].pinFunc == OUTPUT )
       {
+          pinOutputs |= 1UL << i;
+
           // increase drive strength on output pins
           // see ttf/variants.cpp for the data in g_APinDescription[]
           // NOTE: this will source 7mA, sink 10mA
@@ -181,16 +290,19 @@ void monitorsInit(void)
 
 /**
   * @name   readPin
-  * @brief  wrapper to digitalRead via pinStates[]
+  * @brief  read an input pin straight from PORT IN into pinStates[]
   * @param  None
   * @retval None
   */
 bool readPin(uint8_t pinNo)
 {
-    uint8_t         index = getPinIndex(pinNo);
+    int8_t          index = getPinIndex(pinNo);
+
+    if ( index < 0 )
+        return(0);
 
     if ( staticPins[index].pinFunc == INPUT )
-        pinStates[index] = digitalRead((pin_size_t) pinNo);
+        pinStates[index] = (PORT->Group[pinPorts[index].port].IN.reg & pinPorts[index].mask) ? 1 : 0;
 
     return(pinStates[index]);
 }
@@ -206,20 +318,133 @@ void writePin(uint8_t pinNo, uint8_t value)
 {
     value = (value == 0) ? 0 : 1;
     digitalWrite(pinNo, value);
-    pinStates[getPinIndex(pinNo)] = (bool) value;
+
+    if ( getPinIndex(pinNo) >= 0 )
+        pinStates[getPinIndex(pinNo)] = (bool) value;
+}
+
+/**
+  * @name   pinBit
+  * @brief  a pin's bit in pin bitmaps
+  * @param  pinNo Arduino pin #
+  * @retval 1 << staticPins[] index, 0 if the pin has no entry
+  */
+uint32_t pinBit(int pinNo)
+{
+    int8_t          index = getPinIndex(pinNo);
+
+    return((index < 0) ? 0 : 1UL << index);
+}
+
+/**
+  * @name   pinGroupBits
+  * @brief  a pin group as a pin bitmap
+  * @param  group PIN_GROUP_xxx
+  * @retval bit n set for staticPins[n] in the group
+  */
+uint32_t pinGroupBits(pin_group_t group)
+{
+    return(pinGroups[group]);
+}
+
+/**
+  * @name   writePortMasks
+  * @brief  drive PORT bits high and low together
+  * @param  set PORTA and PORTB bits to drive high
+  * @param  clr PORTA and PORTB bits to drive low
+  * @retval None
+  * @note   one OUTSET or OUTCLR write per port if all bits go the same
+  *         way; otherwise one OUTTGL write of the bits that have to
+  *         change, with interrupts off so an ISR can't change OUT in
+  *         between
+  */
+static void writePortMasks(const uint32_t *set, const uint32_t *clr)
+{
+    for ( int port = PORTA; port <= PORTB; port++ )
+    {
+        if ( set[port] != 0 && clr[port] != 0 )
+        {
+            noInterrupts();
+            PORT->Group[port].OUTTGL.reg = (PORT->Group[port].OUT.reg ^ set[port]) & (set[port] | clr[port]);
+            interrupts();
+        }
+        else if ( set[port] != 0 )
+        {
+            PORT->Group[port].OUTSET.reg = set[port];
+        }
+        else if ( clr[port] != 0 )
+        {
+            PORT->Group[port].OUTCLR.reg = clr[port];
+        }
+    }
+}
+
+/**
+  * @name   writePinGroup
+  * @brief  drive every pin in a group to the same level at once
+  * @param  group PIN_GROUP_xxx
+  * @param  value 0 or 1
+  * @retval None
+  */
+void writePinGroup(pin_group_t group, uint8_t value)
+{
+    static const uint32_t   none[2] = { 0, 0 };
+
+    if ( value )
+        writePortMasks(pinGroupPorts[group], none);
+    else
+        writePortMasks(none, pinGroupPorts[group]);
+
+    for ( int i = 0; i < static_pin_count; i++ )
+    {
+        if ( pinGroups[group] & (1UL << i) )
+            pinStates[i] = value ? 1 : 0;
+    }
+}
+
+/**
+  * @name   writePinMask
+  * @brief  write several output pins at once
+  * @param  mask pins to write, bit n = staticPins[n] ('pins' order)
+  * @param  levels level for each pin in mask
+  * @retval false if mask has pins that aren't outputs, nothing written
+  */
+bool writePinMask(uint32_t mask, uint32_t levels)
+{
+    uint32_t        set[2] = { 0, 0 };
+    uint32_t        clr[2] = { 0, 0 };
+
+    if ( mask & ~pinOutputs )
+        return(false);
+
+    for ( int i = 0; i < static_pin_count; i++ )
+    {
+        if ( (mask & (1UL << i)) == 0 )
+            continue;
+
+        if ( levels & (1UL << i) )
+            set[pinPorts[i].port] |= pinPorts[i].mask;
+        else
+            clr[pinPorts[i].port] |= pinPorts[i].mask;
+
+        pinStates[i] = (levels & (1UL << i)) ? 1 : 0;
+    }
+
+    writePortMasks(set, clr);
+    return(true);
 }
 
 /**
   * @name   readCmd
   * @brief  read an I/O pin
-  * @param  arg 1 = Arduino pin #
-  * @retval 0=OK 1=pin # not found
+  * @param  cliArgs[0] = Arduino pin # (validated by the CLI)
+  * @retval 0=OK 1=card not present
   * @note   displays pin info
   */
 int readCmd(int arg)
 {
-    uint8_t       pinNo = atoi(tokens[1]);
-    uint8_t       index = getPinIndex(pinNo);
+    uint8_t       pinNo = cliArgs[0].i;
+    int8_t        index = getPinIndex(pinNo);
 
     if ( isCardPresent() == false )
     {
@@ -227,12 +452,6 @@ int readCmd(int arg)
         return(1);
     }
 
-    if ( pinNo > PINS_COUNT )
-    {
-        terminalOut((char *) "Invalid pin number; please use Arduino numbering");
-        return(1);
-    }
-
     (void) readPin(pinNo);
     sprintf(outBfr, "%s Pin %d (%s) = %d", (staticPins[index].pinFunc == INPUT) ? "Input" : "Output", 
             pinNo, getPinName(pinNo), pinStates[index]);
@@ -242,16 +461,19 @@ int readCmd(int arg)
 
 /**
   * @name   writeCmd
-  * @brief  write a pin with 0 or 1
-  * @param  arg 1 Arduino pin #
-  * @param  arg 2 value to write
+  * @brief  write a pin with 0 or 1, or several pins at once
+  * @param  cliArgs[0] Arduino pin # or name, or "mask"
+  * @param  cliArgs[1] value to write, 0 or 1; pin mask for "mask"
+  * @param  cliArgs[2] pin levels for "mask"
   * @retval None
+  * @note   masks are bit n = staticPins[n], the 'pins' order
   */
 int writeCmd(int argCnt)
 {
-    uint8_t     pinNo = atoi(tokens[1]);
-    uint8_t     value = atoi(tokens[2]);
-    uint8_t     index = getPinIndex(pinNo);
+    const char  *arg = cliArgs[0].s;
+    int         pinNo;
+    uint32_t    value = cliArgs[1].u;
+    int8_t      index;
 
     if ( isCardPresent() == false )
     {
@@ -259,27 +481,48 @@ int writeCmd(int argCnt)
         return(1);
     }
 
-    if ( pinNo > PINS_COUNT || index == -1 )
+    if ( strcasecmp(arg, "mask") == 0 )
     {
-        terminalOut((char *) "Invalid pin number; use 'pins' command for help.");
-        return(1);
-    }    
+        if ( argCnt != 3 )
+        {
+            terminalOut((char *) "Usage: write mask <pins hex> <levels hex>");
+            return(1);
+        }
 
-    if ( staticPins[index].pinFunc == INPUT )
+        if ( writePinMask(value, cliArgs[2].u) == false )
+        {
+            terminalOut((char *) "Mask includes input pins! Use 'pins' command for help.");
+            return(1);
+        }
+
+        sprintf(outBfr, "Wrote %08lX to pin mask %08lX", (unsigned long) (cliArgs[2].u & value), (unsigned long) value);
+        terminalOut(outBfr);
+        return(0);
+    }
+
+    pinNo = cliParsePin(arg);
+    index = getPinIndex(pinNo);
+    if ( pinNo < 0 )
     {
-        terminalOut((char *) "Cannot write to an input pin! Use 'pins' command for help.");
+        terminalOut((char *) "Not a valid pin; use 'pins' command for help");
         return(1);
-    }  
+    }
 
-    if ( value != 0 && value != 1 )
+    if ( value > 1 )
     {
-        terminalOut((char *) "Invalid pin value; please enter either 0 or 1");
+        terminalOut((char *) "Value must be 0 or 1");
         return(1);
     }
 
+    if ( staticPins[index].pinFunc == INPUT )
+    {
+        terminalOut((char *) "Cannot write to an input pin! Use 'pins' command for help.");
+        return(1);
+    }  
+
     writePin(pinNo, value);
 
-    sprintf(outBfr, "Wrote %d to pin # %d (%s)", value, pinNo, getPinName(pinNo));
+    sprintf(outBfr, "Wrote %d to pin # %d (%s)", (int) value, pinNo, getPinName(pinNo));
     terminalOut(outBfr);
     return(0);
 }
@@ -289,21 +532,27 @@ int writeCmd(int argCnt)
 //===================================================================
 
 // --------------------------------------------
-// get12VData() - get 12V rail V & I
+// get12VData() - get 12V rail I (mA) & V (mV)
 // --------------------------------------------
-void get12VData(float *v12I, float *v12V)
+void get12VData(int32_t *v12I, int32_t *v12V)
 {
-    *v12I = u2Monitor.shuntCurrent() * 1000.0;
-    *v12V = u2Monitor.busVoltage();
+    uint32_t        start = micros();
+
+    *v12I = INA219_CURRENT_mA(u2Monitor.shuntCurrentRaw());
+    *v12V = INA219_BUS_mV(u2Monitor.busVoltageRaw());
+    perf_probe(PERF_INA219_READ, start);
 }
 
 // --------------------------------------------
-// get 3P3VData() - get 3.3V rail V & I
+// get 3P3VData() - get 3.3V rail I (mA) & V (mV)
 // --------------------------------------------
-void get3P3VData(float *v3p3I, float *v3p3V)
+void get3P3VData(int32_t *v3p3I, int32_t *v3p3V)
 {
-    *v3p3I = u3Monitor.shuntCurrent() * 1000.0;
-    *v3p3V = u3Monitor.busVoltage();    
+    uint32_t        start = micros();
+
+    *v3p3I = INA219_CURRENT_mA(u3Monitor.shuntCurrentRaw());
+    *v3p3V = INA219_BUS_mV(u3Monitor.busVoltageRaw());
+    perf_probe(PERF_INA219_READ, start);
 }
 
 // --------------------------------------------
@@ -311,7 +560,8 @@ void get3P3VData(float *v3p3I, float *v3p3V)
 // --------------------------------------------
 int curCmd(int arg)
 {
-    float           v12I, v12V, v3p3I, v3p3V;
+    int32_t         v12I, v12V, v3p3I, v3p3V;
+    char            *s;
 
     terminalOut((char *) "Acquiring current data, please wait...");
 
@@ -319,16 +569,24 @@ int curCmd(int arg)
     get3P3VData(&v3p3I, &v3p3V);
     delay(100);
 
-    sprintf(outBfr, "12V shunt current:  %d mA", (int) v12I);
+    s = fmt_str(outBfr, "12V shunt current:  ");
+    s = fmt_i32(s, v12I);
+    fmt_str(s, " mA");
     terminalOut(outBfr);
 
-    sprintf(outBfr, "12V bus voltage:    %5.2f V", v12V);
+    s = fmt_str(outBfr, "12V bus voltage:    ");
+    s = fmt_milli(s, v12V, 2, 5);
+    fmt_str(s, " V");
     terminalOut(outBfr);
 
-    sprintf(outBfr, "3.3V shunt current: %d mA", (int) v3p3I);
+    s = fmt_str(outBfr, "3.3V shunt current: ");
+    s = fmt_i32(s, v3p3I);
+    fmt_str(s, " mA");
     terminalOut(outBfr);
 
-    sprintf(outBfr, "3.3V bus voltage:   %5.2f V", v3p3V);
+    s = fmt_str(outBfr, "3.3V bus voltage:   ");
+    s = fmt_milli(s, v3p3V, 2, 5);
+    fmt_str(s, " V");
     terminalOut(outBfr);  
 
     return(0);
@@ -415,141 +673,279 @@ int pinCmd(int arg)
   * @brief  read all I/O pins into pinStates[]
   * @param  None
   * @retval None
+  * @note   both PORT groups are read back to back so every input is
+  *         from the same instant; outputs keep their written state
   */
 void readAllPins(void)
 {
+    uint32_t        in[2];
+
+    in[PORTA] = PORT->Group[PORTA].IN.reg;
+    in[PORTB] = PORT->Group[PORTB].IN.reg;
+
     for ( int i = 0; i < static_pin_count; i++ )
     {
-        (void) readPin(staticPins[i].pinNo);
+        if ( staticPins[i].pinFunc == INPUT )
+            pinStates[i] = (in[pinPorts[i].port] & pinPorts[i].mask) ? 1 : 0;
     }
 }
 
-/**
-  * @name   statusCmd
-  * @brief  display status screen
-  * @param  argCnt = number of CLI arguments
-  * @retval None
-  * @note   card not required present for this to work
-  */
-int statusCmd(int arg)
+// Status screen field sources
+typedef enum {
+    SRC_NONE = 0,               // label only
+    SRC_PINS,                   // one digit per pin, MSB first
+    SRC_PRESENCE,               // PRSNTB[3:0] + derived CARD/VOID
+    SRC_RAIL_12V,               // 12V rail V & I
+    SRC_RAIL_3P3V,              // 3.3V rail V & I
+} status_src_t;
+
+// Status screen fields, in table order
+typedef enum {
+    SF_TITLE = 0,
+    SF_TEMP_WARN,
+    SF_BIF,
+    SF_TEMP_CRIT,
+    SF_PRSNTB,
+    SF_FAN_ON_AUX,
+    SF_SLOT_ID,
+    SF_SCAN_LD_N,
+    SF_SCAN_VER,
+    SF_AUX_PWR_EN,
+    SF_PCIE_PRES_N,
+    SF_MAIN_PWR_EN,
+    SF_WAKE_N,
+    SF_RBT_ISOLATE_EN,
+    SF_PWRBRK_N,
+    SF_NIC_PWR_GOOD,
+    SF_12V,
+    SF_3P3V,
+    SF_COUNT
+} status_field_id_t;
+
+// Status screen layout entry.  'label' and 'at' are the cursor escape
+// sequences pre-rendered at compile time, 'label' includes the label
+// text so drawing a label or positioning a value is a single write.
+typedef struct {
+    uint8_t         id;
+    uint8_t         row;
+    uint8_t         labelCol;
+    uint8_t         col;            // value column
+    uint8_t         labelLen;
+    const char      *label;
+    const char      *at;
+    uint8_t         src;
+    uint8_t         pinCnt;
+    uint8_t         pins[4];
+} status_field_t;
+
+#define STATUS_AT(r, c)             "\x1b[" #r ";" #c "f"
+#define STATUS_FIELD(id, r, c, vc, label, src, n, p0, p1, p2, p3) \
+    { id, r, c, vc, sizeof(label) - 1, STATUS_AT(r, c) label, STATUS_AT(r, vc), src, n, { p0, p1, p2, p3 } }
+
+// the row/column arguments must be literals, they are stringified
+static constexpr status_field_t statusLayout[] = {
+    STATUS_FIELD(SF_TITLE,          1, 29, 50, "Xavier Status Display",  SRC_NONE,      0, 0, 0, 0, 0),
+    STATUS_FIELD(SF_TEMP_WARN,      3,  1, 19, "TEMP WARN         ",     SRC_PINS,      1, TEMP_WARN, 0, 0, 0),
+    STATUS_FIELD(SF_BIF,            3, 57, 72, "BIF [2:0]      ",        SRC_PINS,      3, OCP_BIF2_N, OCP_BIF1_N, OCP_BIF0_N, 0),
+    STATUS_FIELD(SF_TEMP_CRIT,      4,  1, 19, "TEMP CRIT         ",     SRC_PINS,      1, TEMP_CRIT, 0, 0, 0),
+    STATUS_FIELD(SF_PRSNTB,         4, 56, 71, "PRSNTB [3:0]   ",        SRC_PRESENCE,  4, OCP_PRSNTB3_N, OCP_PRSNTB2_N, OCP_PRSNTB1_N, OCP_PRSNTB0_N),
+    STATUS_FIELD(SF_FAN_ON_AUX,     5,  1, 19, "FAN ON AUX        ",     SRC_PINS,      1, FAN_ON_AUX, 0, 0, 0),
+    STATUS_FIELD(SF_SLOT_ID,        5, 53, 73, "SLOT ID [1:0]       ",   SRC_PINS,      2, OCP_SLOT_ID1, OCP_SLOT_ID0, 0, 0),
+    STATUS_FIELD(SF_SCAN_LD_N,      6,  1, 19, "SCAN_LD_N         ",     SRC_PINS,      1, OCP_SCAN_LD_N, 0, 0, 0),
+    STATUS_FIELD(SF_SCAN_VER,       6, 51, 73, "SCAN VERS [1:0]       ", SRC_PINS,      2, SCAN_VER_1, SCAN_VER_0, 0, 0),
+    STATUS_FIELD(SF_AUX_PWR_EN,     7,  1, 19, "AUX_PWR_EN        ",     SRC_PINS,      1, OCP_AUX_PWR_EN, 0, 0, 0),
+    STATUS_FIELD(SF_PCIE_PRES_N,    7, 56, 74, "PCIE_PRES_N       ",     SRC_PINS,      1, PCIE_PRES_N, 0, 0, 0),
+    STATUS_FIELD(SF_MAIN_PWR_EN,    8,  1, 19, "MAIN_PWR_EN       ",     SRC_PINS,      1, OCP_MAIN_PWR_EN, 0, 0, 0),
+    STATUS_FIELD(SF_WAKE_N,         8, 58, 74, "OCP_WAKE_N      ",       SRC_PINS,      1, OCP_WAKE_N, 0, 0, 0),
+    STATUS_FIELD(SF_RBT_ISOLATE_EN, 9,  1, 19, "RBT_ISOLATE_EN    ",     SRC_PINS,      1, RBT_ISOLATE_EN, 0, 0, 0),
+    STATUS_FIELD(SF_PWRBRK_N,       9, 57, 74, "OCP_PWRBRK_N     ",      SRC_PINS,      1, OCP_PWRBRK_N, 0, 0, 0),
+    STATUS_FIELD(SF_NIC_PWR_GOOD,  10,  1, 19, "jmp_NIC_PWR_GOOD  ",     SRC_PINS,      1, NIC_PWR_GOOD, 0, 0, 0),
+    STATUS_FIELD(SF_12V,           11,  1,  6, "12V: ",                  SRC_RAIL_12V,  0, 0, 0, 0, 0),
+    STATUS_FIELD(SF_3P3V,          11, 55, 61, "3.3V: ",                 SRC_RAIL_3P3V, 0, 0, 0, 0, 0),
+};
+
+// compile time layout checks: one entry per field id in order, and
+// each value column lands right after its label
+constexpr bool statusLayoutOk(unsigned i)
 {
-    uint16_t        count = EEPROMData.status_delay_secs;
-    bool            oneShot = (count == 0) ? true : false;
-    float             v12I, v12V, v3p3I, v3p3V;
-    
-    while ( 1 )
-    {
-      // get voltages and currents
-      get12VData(&v12I, &v12V);
-      get3P3VData(&v3p3I, &v3p3V);
+    return (i >= SF_COUNT) ? true :
+           (statusLayout[i].id == i &&
+            statusLayout[i].col == statusLayout[i].labelCol + statusLayout[i].labelLen &&
+            statusLayoutOk(i + 1));
+}
 
-      readAllPins();
+static_assert(sizeof(statusLayout) / sizeof(status_field_t) == SF_COUNT, "statusLayout[] must have one entry per status field");
+static_assert(statusLayoutOk(0), "statusLayout[] entry out of order or value column doesn't follow label");
 
-      CLR_SCREEN();
-      CURSOR(1, 29);
-      displayLine((char *) "Xavier Status Display");
+static const char       statusOneShotMsg[] = STATUS_AT(12, 1) "Status delay 0, set sdelay to nonzero for this screen to loop.";
+static const char       statusExitMsg[] = STATUS_AT(24, 22) "Hit any key to exit this display";
+static const char       statusPark[] = STATUS_AT(13, 1);
 
-      CURSOR(3,1);
-      sprintf(outBfr, "TEMP WARN         %d", readPin(TEMP_WARN));
-      displayLine(outBfr);
+// Status screen shadow frame: the last value sent for each field so a
+// refresh only sends the fields that changed.
+#define STATUS_CELL_SZ              20
 
-      CURSOR(3,57);
-      sprintf(outBfr, "BIF [2:0]      %u%u%u", readPin(OCP_BIF2_N), readPin(OCP_BIF1_N), readPin(OCP_BIF0_N));
-      displayLine(outBfr);
+static char             statusShadow[SF_COUNT][STATUS_CELL_SZ];
+static uint32_t         statusLastRefresh;
 
-      CURSOR(4,1);
-      sprintf(outBfr, "TEMP CRIT         %u", readPin(TEMP_CRIT));
-      displayLine(outBfr);
+/**
+  * @name   statusFormat
+  * @brief  format the current value of a status field
+  * @param  f layout entry
+  * @param  val buffer of STATUS_CELL_SZ chars for the value
+  * @param  rails 12V mA, 12V mV, 3.3V mA, 3.3V mV sampled for this frame
+  * @retval None
+  */
+static void statusFormat(const status_field_t *f, char *val, const int32_t *rails)
+{
+    char            *s = val;
 
-        CURSOR(4,56);
-        sprintf(outBfr, "PRSNTB [3:0]   %u%u%u%u %s", readPin(OCP_PRSNTB3_N), readPin(OCP_PRSNTB2_N), 
-                readPin(OCP_PRSNTB1_N), readPin(OCP_PRSNTB0_N), isCardPresent() ? "CARD" : "VOID");
-        displayLine(outBfr);
+    switch ( f->src )
+    {
+        case SRC_PINS:
+        case SRC_PRESENCE:
+            for ( int i = 0; i < f->pinCnt; i++ )
+                *s++ = '0' + readPin(f->pins[i]);
+            *s = 0;
+
+            if ( f->src == SRC_PRESENCE )
+                fmt_str(s, isCardPresent() ? " CARD" : " VOID");
+            break;
+
+        case SRC_RAIL_12V:
+        case SRC_RAIL_3P3V:
+            if ( f->src == SRC_RAIL_3P3V )
+                rails += 2;
+
+            s = fmt_milli(s, rails[1], 2, 5);
+            *s++ = ' ';
+            s = fmt_i32(s, rails[0]);
+            fmt_str(s, " mA");
+            break;
+
+        default:
+            *s = 0;
+            break;
+    }
+}
 
-      CURSOR(5,1);
-      sprintf(outBfr, "FAN ON AUX        %u", readPin(FAN_ON_AUX));
-      displayLine(outBfr);
+/**
+  * @name   statusDrawFrame
+  * @brief  clear the screen and draw the static status labels
+  * @param  oneShot true if the screen won't be refreshed
+  * @retval None
+  */
+static void statusDrawFrame(bool oneShot)
+{
+    CLR_SCREEN();
 
-      CURSOR(5,53);
-      sprintf(outBfr, "SLOT ID [1:0]       %u%u", readPin(OCP_SLOT_ID1), readPin(OCP_SLOT_ID0));
-      displayLine(outBfr);
+    for ( int i = 0; i < SF_COUNT; i++ )
+        term_puts(statusLayout[i].label);
 
-      CURSOR(6,1);
-      sprintf(outBfr, "SCAN_LD_N         %d", readPin(OCP_SCAN_LD_N));
-      displayLine(outBfr);
+    term_puts(oneShot ? statusOneShotMsg : statusExitMsg);
 
-      CURSOR(6,51);
-      sprintf(outBfr, "SCAN VERS [1:0]       %u%u", readPin(SCAN_VER_1), readPin(SCAN_VER_0));
-      displayLine(outBfr);
+    // force every field to be sent on the first refresh
+    memset(statusShadow, 0, sizeof(statusShadow));
+}
 
-      CURSOR(7,1);
-      sprintf(outBfr, "AUX_PWR_EN        %d", readPin(OCP_AUX_PWR_EN));
-      displayLine(outBfr);      
+/**
+  * @name   statusRefresh
+  * @brief  sample pins & rails and send the fields that changed
+  * @param  None
+  * @retval None
+  */
+static void statusRefresh(void)
+{
+    char                    val[STATUS_CELL_SZ];
+    int32_t                 rails[4];
+    const status_field_t    *f;
+    char                    *shadow;
+    int                     oldLen;
+    int                     len;
 
-      CURSOR(7,56);
-      sprintf(outBfr, "PCIE_PRES_N       %d", readPin(PCIE_PRES_N));
-      displayLine(outBfr);
+    // get voltages and currents
+    get12VData(&rails[0], &rails[1]);
+    get3P3VData(&rails[2], &rails[3]);
 
-      CURSOR(8,1);
-      sprintf(outBfr, "MAIN_PWR_EN       %d", readPin(OCP_MAIN_PWR_EN));
-      displayLine(outBfr);  
+    readAllPins();
 
-      CURSOR(8,58);
-      sprintf(outBfr, "OCP_WAKE_N      %d", readPin(OCP_WAKE_N));
-      displayLine(outBfr);
+    for ( int i = 0; i < SF_COUNT; i++ )
+    {
+        f = &statusLayout[i];
+        if ( f->src == SRC_NONE )
+            continue;
 
-      CURSOR(9,1);
-      sprintf(outBfr, "RBT_ISOLATE_EN    %d", readPin(RBT_ISOLATE_EN));
-      displayLine(outBfr);  
+        statusFormat(f, val, rails);
 
-      CURSOR(9,57);
-      sprintf(outBfr, "OCP_PWRBRK_N     %d", readPin(OCP_PWRBRK_N));
-      displayLine(outBfr);
+        shadow = statusShadow[i];
+        if ( strcmp(shadow, val) == 0 )
+            continue;
 
-      CURSOR(10,1);
-      sprintf(outBfr, "jmp_NIC_PWR_GOOD  %d", readPin(NIC_PWR_GOOD));
-      displayLine(outBfr);  
+        oldLen = strlen(shadow);
+        len = strlen(val);
 
-      CURSOR(11,1);
-      sprintf(outBfr, "12V: %5.2f %d  mA", v12V, (int) v12I);
-      displayLine(outBfr);
+        term_puts(f->at);
+        term_write(val, len);
 
-      CURSOR(11,55);
-      sprintf(outBfr, "3.3V: %5.2f %d mA", v3p3V, (int) v3p3I);
-      displayLine(outBfr);
+        // blank out what's left of a longer previous value
+        while ( len++ < oldLen )
+            term_putc(' ');
 
-        if ( oneShot )
-        {
-            CURSOR(12,1);
-            displayLine((char *) "Status delay 0, set sdelay to nonzero for this screen to loop.");
-            return(0);
-        }
-      CURSOR(24, 22);
-      displayLine((char *) "Hit any key to exit this display");
+        strcpy(shadow, val);
+    }
 
-        while ( count-- > 0 )
-        {
-            if ( SerialUSB.available() )
-            {
-                // flush any user input and exit
-                (void) SerialUSB.read();
+    // park the cursor below the values and send the batch
+    term_puts(statusPark);
+    term_flush();
+}
 
-                while ( SerialUSB.available() )
-                {
-                    (void) SerialUSB.read();
-                }
+/**
+  * @name   statusStep
+  * @brief  status screen job, refreshes every sdelay secs
+  * @param  cancel true when a key was pressed
+  * @retval CLI_JOB_RUNNING, or 0 when cancelled
+  */
+static int statusStep(bool cancel)
+{
+    if ( cancel )
+    {
+        CLR_SCREEN();
+        return(0);
+    }
 
-                CLR_SCREEN();
-                return(0);
-            }
+    if ( millis() - statusLastRefresh >= EEPROMData.status_delay_secs * 1000UL )
+    {
+        statusLastRefresh = millis();
+        statusRefresh();
+    }
 
-            delay(1000);
-        }
+    return(CLI_JOB_RUNNING);
+}
 
-        count = EEPROMData.status_delay_secs;
-    }
+/**
+  * @name   statusCmd
+  * @brief  display status screen
+  * @param  argCnt = number of CLI arguments
+  * @retval None
+  * @note   card not required present for this to work
+  * @note   layout is statusLayout[]; labels are drawn once and
+  *         refreshes only send changed values
+  * @note   with a refresh delay set the screen is kept up to date
+  *         by statusStep() as a job until a key is pressed; in lists,
+  *         scripts and protocol requests it is drawn once
+  */
+int statusCmd(int arg)
+{
+    bool            oneShot = (EEPROMData.status_delay_secs == 0 || !cliJobDetached()) ? true : false;
 
-    return(0);
+    statusDrawFrame(oneShot);
+    statusRefresh();
+    statusLastRefresh = millis();
+
+    if ( oneShot )
+        return(0);
+
+    return(cliJobStart(statusStep));
 
 } // statusCmd()
 
@@ -562,27 +958,66 @@ int statusCmd(int arg)
   */
 const char *getPinName(int pinNo)
 {
-    for ( int i = 0; i < static_pin_count; i++ )
-    {
-        if ( pinNo == staticPins[i].pinNo )
-            return(staticPins[i].name);
-    }
+    int8_t          index = getPinIndex(pinNo);
 
-    return("Unknown");
+    return((index < 0) ? "Unknown" : staticPins[index].name);
 }
 
 /**
   * @name   getPinIndex
   * @brief  get index into static/dynamic pin arrays
   * @param  Arduino pin number
-  * @retval None
+  * @retval index, -1 if the pin isn't in staticPins[]
+  * @note   constant pin numbers can use pinIndexOf() at compile time
   */
-int8_t getPinIndex(uint8_t pinNo)
+int8_t getPinIndex(int pinNo)
+{
+    if ( pinNo < 0 || pinNo >= (int) PINS_COUNT )
+        return(-1);
+
+    return(pinIndexMap[pinNo]);
+}
+
+/**
+  * @name   getPinByIndex
+  * @brief  get a staticPins[] entry
+  * @param  index table index, see getPinIndex()
+  * @retval pointer to the entry, NULL past the end of the table
+  */
+const pin_mgt_t *getPinByIndex(int index)
+{
+    if ( index < 0 || index >= (int) STATIC_PIN_CNT )
+        return(NULL);
+
+    return(&staticPins[index]);
+}
+
+/**
+  * @name   getPinPortMask
+  * @brief  PORT group and bit of a staticPins[] entry
+  * @param  index table index, see getPinIndex()
+  * @param  port where to return the PORT group
+  * @retval bit mask in the group's registers
+  * @note   from pinPorts[], valid once configureIOPins() has run
+  */
+uint32_t getPinPortMask(int index, uint8_t *port)
+{
+    *port = pinPorts[index].port;
+    return(pinPorts[index].mask);
+}
+
+/**
+  * @name   getPinByName
+  * @brief  look up a pin by its name as shown by the 'pins' command
+  * @param  name pin name, case insensitive
+  * @retval Arduino pin number or -1 if not found
+  */
+int getPinByName(const char *name)
 {
     for ( int i = 0; i < static_pin_count; i++ )
     {
-        if ( staticPins[i].pinNo == pinNo )
-            return(i);
+        if ( strcasecmp(staticPins[i].name, name) == 0 )
+            return(staticPins[i].pinNo);
     }
 
     return(-1);
@@ -610,55 +1045,40 @@ void set_help(void)
 /**
   * @name   setCmd
   * @brief  Set a parameter (seeing) in FLASH
-  * @param  arg 1 = parameter name
-  * @param  arg 2 = value to set
+  * @param  cliArgs[0] = parameter keyword index
+  * @param  cliArgs[1] = value to set
   * @retval 0
   * @note   no args shows help w/current values
   * @note   simulated EEPROM is called FLASH to the user
   */
 int setCmd(int argCnt)
 {
-
-    char          *parameter = tokens[1];
-    String        valueEntered = tokens[2];
-//    float         fValue;
-    int           iValue;
+    uint16_t      value = cliArgs[1].i;
+    uint16_t      *param;
     bool          isDirty = false;
 
-    if ( argCnt == 0 )
-    {
-        set_help();
-        return(0);
-    }
-    else if ( argCnt != 2 )
+    if ( argCnt != 2 )
     {
         set_help();
         return(0);
     }
 
-    if ( strcmp(parameter, "sdelay") == 0 )
+    switch ( cliArgs[0].i )
     {
-        iValue = valueEntered.toInt();
-        if (EEPROMData.status_delay_secs != iValue )
-        {
-          isDirty = true;
-          EEPROMData.status_delay_secs = iValue;
-        }
-    }
-    else if ( strcmp(parameter, "pdelay") == 0 )
-    {
-        iValue = valueEntered.toInt();
-        if (EEPROMData.pwr_seq_delay_msec != iValue )
-        {
-          isDirty = true;
-          EEPROMData.pwr_seq_delay_msec = iValue;
-        }
+        case SET_SDELAY:
+            param = &EEPROMData.status_delay_secs;
+            break;
+
+        case SET_PDELAY:
+        default:
+            param = &EEPROMData.pwr_seq_delay_msec;
+            break;
     }
-    else
+
+    if ( *param != value )
     {
-        terminalOut((char *) "Invalid parameter name");
-        set_help();
-        return(1);
+        isDirty = true;
+        *param = value;
     }
 
     if ( isDirty == true )
@@ -721,16 +1141,73 @@ static void pwrCmdHelp(void)
     terminalOut((char *) "  card = MAIN_EN=1 then pdelay msecs then AUX_EN=1; see 'set' command for pdelay");
 }
 
+// 'power up card' sequence, run as a job by pwrUpStep()
+#define PWR_SCAN_WAIT_MSEC          2000
+
+typedef enum {
+    PWR_SEQ_AUX_WAIT = 0,   // MAIN_EN is on, waiting pdelay for AUX_EN
+    PWR_SEQ_SCAN_WAIT,      // AUX_EN is on, waiting for scan chain data
+
+} pwr_seq_t;
+
+static pwr_seq_t        pwrSeqState;
+static uint32_t         pwrSeqTime;
+
+/**
+  * @name   pwrUpStep
+  * @brief  power up card sequence job
+  * @param  cancel true when a key was pressed
+  * @retval CLI_JOB_RUNNING until done, then 0; 1 when cancelled
+  * @note   a cancelled sequence leaves the enables as they are,
+  *         use 'power down card' to turn them off
+  */
+static int pwrUpStep(bool cancel)
+{
+    if ( cancel )
+    {
+        sprintf(outBfr, "Power up sequence cancelled, MAIN_EN = %d AUX_EN = %d",
+                pinStates[pinIndexOf(OCP_MAIN_PWR_EN)], pinStates[pinIndexOf(OCP_AUX_PWR_EN)]);
+        SHOW();
+        return(1);
+    }
+
+    switch ( pwrSeqState )
+    {
+        case PWR_SEQ_AUX_WAIT:
+            if ( millis() - pwrSeqTime < EEPROMData.pwr_seq_delay_msec )
+                break;
+
+            writePin(OCP_AUX_PWR_EN, 1);
+            terminalOut((char *) "Waiting for scan chain data...");
+            pwrSeqState = PWR_SEQ_SCAN_WAIT;
+            pwrSeqTime = millis();
+            break;
+
+        case PWR_SEQ_SCAN_WAIT:
+        default:
+            if ( millis() - pwrSeqTime < PWR_SCAN_WAIT_MSEC )
+                break;
+
+            queryScanChain(false);
+            queryScanChain(true);
+            terminalOut((char *) "Power up sequence complete");
+            return(0);
+    }
+
+    return(CLI_JOB_RUNNING);
+}
+
 /**
   * @name   pwrCmd
   * @brief  Control AUX and MAIN power to NIC 3.0 board
   * @param  argCnt  number of arguments
-  * @param  tokens[1]  up, down or status
-  * @param  tokens[2]   main, aux or card
+  * @param  cliArgs[0]  PWR_UP, PWR_DOWN or PWR_STATUS
+  * @param  cliArgs[1]  PWR_MAIN, PWR_AUX or PWR_CARD
   * @retval 0   OK
   * @retval 1   error
   * @note   Delay is changed with 'set pdelay <msec>'
   * @note   power <up|down|status> <main|aux|board> status has no 2nd arg
+  * @note   'power up card' continues as a job, see pwrUpStep()
   */
 int pwrCmd(int argCnt)
 {
@@ -738,6 +1215,8 @@ int pwrCmd(int argCnt)
     bool            isPowered = false;
     uint8_t         mainPin = readPin(OCP_MAIN_PWR_EN);
     uint8_t         auxPin = readPin(OCP_AUX_PWR_EN);
+    int             action = cliArgs[0].i;
+    int             target = cliArgs[1].i;
 
     if ( argCnt == 0 )
     {
@@ -754,9 +1233,9 @@ int pwrCmd(int argCnt)
     if (  mainPin == 1 &&  auxPin == 1 )
         isPowered = true;
 
-    if ( argCnt == 1 )
+    if ( action == PWR_STATUS )
     {
-        if ( strcmp(tokens[1], "status") == 0 )
+        if ( argCnt == 1 )
         {
             sprintf(outBfr, "Status: NIC card is powered %s", (isPowered) ? "up" : "down");
             SHOW();
@@ -776,29 +1255,25 @@ int pwrCmd(int argCnt)
         return(1);
     }
 
-    if ( strcmp(tokens[1], "up") == 0 )
+    if ( action == PWR_UP )
     {
-        if ( strcmp(tokens[2], "card") == 0 )
+        if ( target == PWR_CARD )
         {
             if ( isPowered == false )
             {
                 sprintf(outBfr, "Starting NIC power up sequence, delay = %d msec", EEPROMData.pwr_seq_delay_msec);
                 SHOW();
                 writePin(OCP_MAIN_PWR_EN, 1);
-                delay(EEPROMData.pwr_seq_delay_msec);
-                writePin(OCP_AUX_PWR_EN, 1);
-                terminalOut((char *) "Waiting for scan chain data...");
-                delay(2000);
-                queryScanChain(false);
-                queryScanChain(true);
-                terminalOut((char *) "Power up sequence complete");
+                pwrSeqState = PWR_SEQ_AUX_WAIT;
+                pwrSeqTime = millis();
+                return(cliJobStart(pwrUpStep));
             }
             else
             {
                 terminalOut((char *) "Power is already up on NIC card");
             }
         }
-        else if ( strcmp(tokens[2], "main") == 0 )
+        else if ( target == PWR_MAIN )
         {
             if ( mainPin == 1 )
             {
@@ -812,7 +1287,7 @@ int pwrCmd(int argCnt)
                 return(0);
             }
         }
-        else if ( strcmp(tokens[2], "aux") == 0 )
+        else
         {
             if ( auxPin == 1 )
             {
@@ -826,21 +1301,14 @@ int pwrCmd(int argCnt)
                 return(0);
             }
         }
-        else
-        {
-            terminalOut((char *) "Invalid argument");
-            pwrCmdHelp();
-            return(1);
-        }
     }
-    else if ( strcmp(tokens[1], "down") == 0 )
+    else
     {
-        if ( strcmp(tokens[2], "card") == 0 )
+        if ( target == PWR_CARD )
         {
             if ( isPowered == true )
             {
-                writePin(OCP_MAIN_PWR_EN, 0);
-                writePin(OCP_AUX_PWR_EN, 0);
+                writePinGroup(PIN_GROUP_PWR_EN, 0);
                 terminalOut((char *) "Powered down NIC card");
             }
             else
@@ -848,7 +1316,7 @@ int pwrCmd(int argCnt)
                 terminalOut((char *) "Power is already down on NIC card");
             }
         }
-        else if ( strcmp(tokens[2], "main") == 0 )
+        else if ( target == PWR_MAIN )
         {
             if ( mainPin == 0 )
             {
@@ -862,7 +1330,7 @@ int pwrCmd(int argCnt)
                 return(0);
             }
         }
-        else if ( strcmp(tokens[2], "aux") == 0 )
+        else
         {
             if ( auxPin == 0 )
             {
@@ -876,17 +1344,6 @@ int pwrCmd(int argCnt)
                 return(0);
             }
         }
-        else
-        {
-            terminalOut((char *) "Invalid argument");
-            pwrCmdHelp();
-            return(1);
-        }
-    }
-    else
-    {
-        terminalOut((char *) "Invalid subcommand: use 'up', 'down' or 'status'");
-        rc = 1;
     }
 
     return(rc);
@@ -905,24 +1362,112 @@ int versCmd(int arg)
     return(0);
 }
 
+//===================================================================
+//                          SNAP Command
+//===================================================================
+
+/**
+  * @name   snapPinLevels
+  * @brief  pin levels from the last readAllPins() as a bitmap
+  * @param  None
+  * @retval bit n is the level of staticPins[n]
+  */
+static uint32_t snapPinLevels(void)
+{
+    uint32_t        levels = 0;
+
+    for ( int i = 0; i < static_pin_count && i < 32; i++ )
+    {
+        if ( pinStates[i] )
+            levels |= (uint32_t) 1 << i;
+    }
+
+    return(levels);
+}
+
+/**
+  * @name   snapCmd
+  * @brief  one line telemetry snapshot for pollers
+  * @param  cliArgs[0] SNAP_CSV (default), SNAP_JSON or SNAP_HEADER
+  * @retval 0
+  * @note   pins are read once and presence/slot come from that same
+  *         snapshot; the scan chain is only captured if a card is
+  *         present, else it is reported as 0
+  */
+int snapCmd(int argCnt)
+{
+    int             format = (argCnt == 0) ? SNAP_CSV : cliArgs[0].i;
+    uint32_t        ms = millis();
+    uint32_t        levels;
+    uint32_t        scan = 0;
+    uint8_t         prsnt;
+    uint8_t         slot;
+    bool            present;
+    int32_t         rails[4];
+    char            *t = outBfr;
+
+    if ( format == SNAP_HEADER )
+    {
+        terminalOut((char *) "snap,ms,present,prsntb,slot,pins,12v_ma,12v_mv,3v3_ma,3v3_mv,scan");
+        return(0);
+    }
+
+    readAllPins();
+    levels = snapPinLevels();
+
+    prsnt = pinStates[pinIndexOf(OCP_PRSNTB0_N)] | (pinStates[pinIndexOf(OCP_PRSNTB1_N)] << 1) |
+            (pinStates[pinIndexOf(OCP_PRSNTB2_N)] << 2) | (pinStates[pinIndexOf(OCP_PRSNTB3_N)] << 3);
+    slot = (pinStates[pinIndexOf(OCP_SLOT_ID1)] << 1) | pinStates[pinIndexOf(OCP_SLOT_ID0)];
+    present = (prsnt != 0xF);
+
+    get12VData(&rails[0], &rails[1]);
+    get3P3VData(&rails[2], &rails[3]);
+
+    if ( present )
+        scan = queryScanChain(false);
+
+    if ( format == SNAP_JSON )
+    {
+        t = fmt_u32(fmt_str(t, "{\"ms\":"), ms);
+        t = fmt_u32(fmt_str(t, ",\"present\":"), present);
+        t = fmt_u32(fmt_str(t, ",\"prsntb\":"), prsnt);
+        t = fmt_u32(fmt_str(t, ",\"slot\":"), slot);
+        t = fmt_hex(fmt_str(t, ",\"pins\":\"0x"), levels, 8);
+        t = fmt_i32(fmt_str(t, "\",\"12v_ma\":"), rails[0]);
+        t = fmt_i32(fmt_str(t, ",\"12v_mv\":"), rails[1]);
+        t = fmt_i32(fmt_str(t, ",\"3v3_ma\":"), rails[2]);
+        t = fmt_i32(fmt_str(t, ",\"3v3_mv\":"), rails[3]);
+        t = fmt_hex(fmt_str(t, ",\"scan\":\"0x"), scan, 8);
+        fmt_str(t, "\"}");
+    }
+    else
+    {
+        t = fmt_u32(fmt_str(t, "snap,"), ms);
+        t = fmt_u32(fmt_str(t, ","), present);
+        t = fmt_u32(fmt_str(t, ","), prsnt);
+        t = fmt_u32(fmt_str(t, ","), slot);
+        t = fmt_hex(fmt_str(t, ","), levels, 8);
+
+        for ( int i = 0; i < 4; i++ )
+            t = fmt_i32(fmt_str(t, ","), rails[i]);
+
+        fmt_hex(fmt_str(t, ","), scan, 8);
+    }
+
+    SHOW();
+    return(0);
+}
+
 /**
   * @name   isCardPresent
   * @brief  Determine if NIC card is present
   * @param  None
   * @retval true if card present, else false
+  * @note   debounced state kept by presence.cpp
   */
 bool isCardPresent(void)
 {
-    uint8_t         present = readPin(OCP_PRSNTB0_N);
-
-    present |= (readPin(OCP_PRSNTB1_N) << 1);
-    present |= (readPin(OCP_PRSNTB2_N) << 2);
-    present |= (readPin(OCP_PRSNTB3_N) << 3);
-
-    if ( present == 0xF )
-        return(false);
-    
-    return(true);
+    return(cardPresence.present);
 }
 
 
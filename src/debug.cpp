@@ -6,60 +6,90 @@
 #include "main.hpp"
 #include "Wire.h"
 #include "eeprom.hpp"
+#include "debug.hpp"
+#include "perf.hpp"
+#include "sched.hpp"
 
 extern uint8_t          eepromAddresses[];
 extern EEPROM_data_t    EEPROMData;
 static char             outBfr[OUTBFR_SIZE];
-extern char             *tokens[];
+
+#define DUMP_BYTES_PER_LINE     16
+#define DUMP_LINE_MAX           80
+
+static const char       dumpHex[] = "0123456789abcdef";
 
 // --------------------------------------------
-// dumpMem() - debug utility to dump memory
+// dumpMemAt() - stream a hex/ASCII dump
+//
+// Lines are formatted straight into the bulk
+// staging buffer, 16 bytes per line, with the
+// first line labelled 'addr'.  Any length can
+// be dumped by calling this repeatedly with
+// consecutive chunks; the caller must call
+// term_bulkFlush() when done.
 // --------------------------------------------
-void dumpMem(unsigned char *s, int len)
+void dumpMemAt(uint32_t addr, unsigned char *s, int len)
 {
-    char        lineBfr[100];
-    char        *t = lineBfr;
-    char        ascii[20];
-    char        *a = ascii;
-    int         lc = 0;
-    int         i = 0;
-
-    while ( i < len )
-    {
-        sprintf(t, "%02x ", *s);
-        t += 3;
-        i++;
+    char        *line;
+    char        *t;
+    int         n;
+    int         i;
 
-        if ( isprint(*s) )
-            *a = *s;
-        else
-            *a = '.';
+    while ( len > 0 )
+    {
+        n = (len > DUMP_BYTES_PER_LINE) ? DUMP_BYTES_PER_LINE : len;
+        line = t = term_bulkReserve(DUMP_LINE_MAX);
 
-        s++;
-        a++;
+        // address prefix
+        for ( i = 12; i >= 0; i -= 4 )
+            *t++ = dumpHex[(addr >> i) & 0xF];
+        *t++ = ':';
+        *t++ = ' ';
 
-        // 16 bytes per line + ascii representation
-        if ( ++lc == 16 )
+        // hex bytes, short last line is padded to keep ASCII aligned
+        for ( i = 0; i < DUMP_BYTES_PER_LINE; i++ )
         {
-            *t = 0;
-            *a = 0;
-            sprintf(outBfr, "%s | %s |", lineBfr, ascii);
-            terminalOut(outBfr);
-
-            lc = 0;
-            t = lineBfr;
-            a = ascii;
+            if ( i < n )
+            {
+                *t++ = dumpHex[s[i] >> 4];
+                *t++ = dumpHex[s[i] & 0xF];
+            }
+            else
+            {
+                *t++ = ' ';
+                *t++ = ' ';
+            }
+            *t++ = ' ';
         }
-    }
 
-    *t = 0;
-    *a = 0;
+        *t++ = ' ';
+        *t++ = '|';
+        *t++ = ' ';
 
-    if ( lineBfr[0] != 0 )
-    {
-        sprintf(outBfr, "%s | %s |", lineBfr, ascii);
-        terminalOut(outBfr);
+        for ( i = 0; i < n; i++ )
+            *t++ = isprint(s[i]) ? s[i] : '.';
+
+        *t++ = ' ';
+        *t++ = '|';
+        *t++ = '\r';
+        *t++ = '\n';
+
+        term_bulkCommit(t - line);
+
+        s += n;
+        addr += n;
+        len -= n;
     }
+}
+
+// --------------------------------------------
+// dumpMem() - debug utility to dump memory
+// --------------------------------------------
+void dumpMem(unsigned char *s, int len)
+{
+    dumpMemAt(0, s, len);
+    term_bulkFlush();
 
 } // dumpMem()
 
@@ -131,6 +161,7 @@ void debug_reset(void)
 {
     terminalOut((char *) "Board reset will disconnect USB-serial connection now.");
     terminalOut((char *) "Repeat whatever steps you took to connect to the board.");
+    term_flush();
     delay(1000);
     NVIC_SystemReset();
 }
@@ -157,6 +188,8 @@ static void debug_help(void)
     terminalOut((char *) "\tscan ..... I2C bus scanner");
     terminalOut((char *) "\treset .... Reset board, requires reconnection to serial");
     terminalOut((char *) "\tflash .... Dump FLASH-simulated EEPROM parameters");
+    terminalOut((char *) "\tperf ..... Command and probe timing, 'perf reset' clears");
+    terminalOut((char *) "\ttasks .... Background task timing, 'tasks reset' clears");
 
     // add new command help here
     // NOTE: debug stuff is not part of CLI so
@@ -167,10 +200,9 @@ static void debug_help(void)
 // debug() - Main debug program
 //
 // arg = number of arguments, if any, not
-// including the debug command itself; args
-// are in ASCII and if intended to be numeric
-// have to be converted to int. tokens[n] is
-// the nth argument after 'debug' 
+// including the debug command itself; the
+// subcommand is parsed by the CLI into
+// cliArgs[0] as a debug_subcmd_t
 // 
 // --------------------------------------------
 int debug(int arg)
@@ -181,21 +213,47 @@ int debug(int arg)
         return(0);
     }
 
-    // very simplistic 'parser' since debug is not part of the requirements
-    // add new 'else if ...' for a new debug command here, add help above,
-    // then add debug_<function>() function above debug() to avoid having to
-    // prototype that function.
-    if ( strcmp(tokens[1], "scan") == 0 )
-      debug_scan();
-    else if ( strcmp(tokens[1], "reset") == 0 )
-      debug_reset();
-    else if ( strcmp(tokens[1], "flash") == 0 )
-      debug_dump_eeprom();
-    else
+    // subcommand keyword is parsed by the CLI, see debugSig[] in cli.cpp;
+    // to add a debug command add its keyword to DEBUG_SUBCMD_KEYWORDS and
+    // the enum in debug.hpp, add help above and a case here
+    switch ( cliArgs[0].i )
     {
-      terminalOut((char *) "Invalid debug command");
-      debug_help();
-      return(1);
+      case DEBUG_SCAN:
+        debug_scan();
+        break;
+
+      case DEBUG_RESET:
+        debug_reset();
+        break;
+
+      case DEBUG_PERF:
+        if ( arg > 1 && cliArgs[1].i == DEBUG_OPT_RESET )
+        {
+            perf_reset();
+            terminalOut((char *) "Perf stats cleared");
+        }
+        else
+        {
+            perf_show();
+        }
+        break;
+
+      case DEBUG_TASKS:
+        if ( arg > 1 && cliArgs[1].i == DEBUG_OPT_RESET )
+        {
+            sched_reset();
+            terminalOut((char *) "Task stats cleared");
+        }
+        else
+        {
+            sched_show();
+        }
+        break;
+
+      case DEBUG_FLASH:
+      default:
+        debug_dump_eeprom();
+        break;
     }
 
     return(0);
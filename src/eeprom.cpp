@@ -10,6 +10,7 @@
 #include "eeprom.hpp"
 #include "cli.hpp"
 #include "commands.hpp"
+#include "perf.hpp"
 
 // uncomment line below to enable hex dumps of EEPROM regions
 //#define EEPROM_DEBUG 1
@@ -52,6 +53,8 @@ byte              EEPROMBuffer[EEPROM_MAX_LEN];
   */
 void readEEPROM(uint8_t i2cAddr, uint32_t eeaddress, uint8_t *dest, uint16_t length)
 {
+  uint32_t    start = micros();
+
   if ( length > EEPROM_MAX_LEN )
     length = EEPROM_MAX_LEN;
 
@@ -67,6 +70,8 @@ void readEEPROM(uint8_t i2cAddr, uint32_t eeaddress, uint8_t *dest, uint16_t len
   {
       *dest++  = Wire.read();
   }
+
+  perf_probe(PERF_EEPROM_READ, start);
 }
 
 // --------------------------------------------
@@ -242,46 +247,40 @@ int eepromCmd(int arg)
 
     if ( arg == 1 )
     {
-        if ( strcmp(tokens[1], "show") != 0 )
+        if ( cliArgs[0].i != EEPROM_SHOW )
         {
             terminalOut((char *) "Invalid subcommand, use 'show' to display EEPROM contents.");
             return(1);
         }
     }
-    else if ( arg == 3 )
+    else if ( arg == 3 && cliArgs[0].i == EEPROM_DUMP )
     {
-        if ( strcmp(tokens[1], "dump") == 0 )
-        {
-            // 'eeprom dump <offset> <length>' command dumps FRU EEPROM at offset for length bytes
-            uint16_t        offset = atoi(tokens[2]);
-            uint16_t        length = atoi(tokens[3]);
-
-            if ( offset > MAX_EEPROM_ADDR )
-            {
-                sprintf(outBfr, "offset of %d exceeds EEPROM capacity, use a smaller number", offset);
-                SHOW();
-                return(1);
-            }
-
-            if ( length > (16 * 20) )
-            {
-                sprintf(outBfr, "length of %d exceeds maximum, use a smaller number", length);
-                SHOW();
-                return(1);
-            }
-
-            readEEPROM(eepromI2CAddr, offset, EEPROMBuffer, length);
-            dumpMem(EEPROMBuffer, length);
-            return(0);
-        }
-        else
+        // 'eeprom dump <offset> <length>' command dumps FRU EEPROM at offset for length bytes
+        // read in EEPROM_MAX_LEN chunks and streamed so the whole EEPROM can be dumped
+        uint32_t        offset = cliArgs[1].i;
+        uint32_t        length = cliArgs[2].i;
+        uint16_t        n;
+
+        if ( length > (MAX_EEPROM_ADDR + 1 - offset) )
         {
-            sprintf(outBfr, "Invalid eeprom subcommand '%s'", tokens[1]);
+            sprintf(outBfr, "length of %d exceeds EEPROM capacity, use a smaller number", (int) length);
             SHOW();
             return(1);
         }
+
+        while ( length > 0 )
+        {
+            n = (length > EEPROM_MAX_LEN) ? EEPROM_MAX_LEN : length;
+            readEEPROM(eepromI2CAddr, offset, EEPROMBuffer, n);
+            dumpMemAt(offset, EEPROMBuffer, n);
+            offset += n;
+            length -= n;
+        }
+
+        term_bulkFlush();
+        return(0);
     }
-    else
+    else if ( arg != 0 )
     {
         showCommandHelp(tokens[0]);
         return(1);
@@ -451,6 +450,48 @@ void EEPROM_Read(void)
     }
 }
 
+// --------------------------------------------
+// EEPROM_readBlock() - copy bytes out of the
+// simulated EEPROM
+// --------------------------------------------
+void EEPROM_readBlock(uint16_t addr, void *dest, uint16_t len)
+{
+    uint8_t         *p = (uint8_t *) dest;
+
+    while ( len-- > 0 )
+        *p++ = EEPROM.read(addr++);
+}
+
+// --------------------------------------------
+// EEPROM_writeBlock() - copy bytes into the
+// simulated EEPROM, EEPROM_commit() saves them
+// --------------------------------------------
+void EEPROM_writeBlock(uint16_t addr, const void *src, uint16_t len)
+{
+    const uint8_t   *p = (const uint8_t *) src;
+
+    while ( len-- > 0 )
+        EEPROM.write(addr++, *p++);
+}
+
+// --------------------------------------------
+// EEPROM_commit() - write the simulated EEPROM
+// to FLASH
+// --------------------------------------------
+void EEPROM_commit(void)
+{
+    EEPROM.commit();
+}
+
+// --------------------------------------------
+// EEPROM_length() - size of the simulated
+// EEPROM in bytes
+// --------------------------------------------
+uint16_t EEPROM_length(void)
+{
+    return(EEPROM.length());
+}
+
 // --------------------------------------------
 // EEPROM_Defaults() - Set defaults in struct
 // --------------------------------------------
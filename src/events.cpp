@@ -0,0 +1,218 @@
+//===================================================================
+// events.cpp
+// GPIO edge journal.  Input pins on an EIC line interrupt on both
+// edges and the handler appends (micros, pin, level) to a ring; the
+// 'events' command drains it, or streams it with 'events live', so
+// short pulses on WAKE, PWRBRK, TEMP_xxx etc. aren't missed between
+// samples.
+//
+// The ring has one producer, the EIC interrupt (all EXTINT lines go
+// through one handler), and one consumer, the CLI, so it needs no
+// locking: the producer only writes evHead and the consumer only
+// writes evTail.  A full ring drops new edges and counts them.
+//
+// EXTINT lines are shared between some pins; the pins without one of
+// their own are:
+//   SCAN_DATA_IN (PA10)   EXTINT10 is OCP_PRSNTB1_N (PB10)
+//   OCP_BIF0_N (PA02)     EXTINT2 is OCP_PRSNTB3_N (PB02)
+//   OCP_PRSNTB0_N (PA18)  EXTINT2 is OCP_PRSNTB3_N (PB02)
+//   OCP_BIF1_N (PA03)     EXTINT3 is OCP_WAKE_N (PB03)
+//   NIC_PWR_GOOD (PA19)   EXTINT3 is OCP_WAKE_N (PB03)
+// The PRSNTB interrupts belong to presence.cpp, which also records
+// their edges here.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "commands.hpp"
+#include "events.hpp"
+#include "fmt.hpp"
+
+#define EVENTS_RING_MASK          (EVENTS_RING_SIZE - 1)
+
+static char             outBfr[OUTBFR_SIZE];
+
+static event_t          evRing[EVENTS_RING_SIZE];
+static volatile uint16_t evHead = 0;
+static volatile uint16_t evTail = 0;
+static volatile uint32_t evDropped = 0;      // only written by the producer
+static uint32_t         evDroppedShown = 0;
+static uint32_t         evLastUs = 0;         // for the time between events
+
+// one handler per pin so it knows which pin fired
+template <uint8_t PIN>
+static void eventsEdge(void)
+{
+    events_record(PIN);
+}
+
+#define EVENT_PIN(pin)      { pin, eventsEdge<pin> }
+
+static const struct {
+    uint8_t         pinNo;
+    voidFuncPtr     isr;
+
+} eventPins[] = {
+    EVENT_PIN(OCP_WAKE_N),
+    EVENT_PIN(OCP_PWRBRK_N),
+    EVENT_PIN(TEMP_WARN),
+    EVENT_PIN(TEMP_CRIT),
+    EVENT_PIN(PCIE_PRES_N),
+    EVENT_PIN(FAN_ON_AUX),
+    EVENT_PIN(OCP_BIF2_N),
+    EVENT_PIN(OCP_SLOT_ID0),
+    EVENT_PIN(OCP_SLOT_ID1),
+    EVENT_PIN(SCAN_VER_0),
+    EVENT_PIN(SCAN_VER_1),
+};
+
+/**
+  * @name   events_Init
+  * @brief  attach the edge interrupts
+  * @param  None
+  * @retval None
+  * @note   call after the pins are configured
+  */
+void events_Init(void)
+{
+    for ( unsigned i = 0; i < sizeof(eventPins) / sizeof(eventPins[0]); i++ )
+        attachInterrupt(digitalPinToInterrupt(eventPins[i].pinNo), eventPins[i].isr, CHANGE);
+}
+
+/**
+  * @name   events_record
+  * @brief  add an edge to the journal
+  * @param  pinNo Arduino pin that changed
+  * @retval None
+  * @note   EIC interrupt context only, it is the ring's one producer
+  */
+void events_record(uint8_t pinNo)
+{
+    uint16_t        head = evHead;
+    event_t         *e;
+    uint8_t         port;
+    uint32_t        mask;
+
+    if ( (uint16_t) (head - evTail) >= EVENTS_RING_SIZE )
+    {
+        evDropped++;
+        return;
+    }
+
+    e = &evRing[head & EVENTS_RING_MASK];
+    e->us = micros();
+    e->pinNo = pinNo;
+    mask = getPinPortMask(getPinIndex(pinNo), &port);
+    e->level = (PORT->Group[port].IN.reg & mask) ? 1 : 0;
+
+    // the record has to be complete before the consumer can see it
+    __DMB();
+    evHead = head + 1;
+}
+
+/**
+  * @name   eventsShow
+  * @brief  print and remove journal records
+  * @param  max most records to show
+  * @retval number shown
+  */
+static int eventsShow(int max)
+{
+    event_t         e;
+    char            *t;
+    int             n = 0;
+
+    while ( n < max && evTail != evHead )
+    {
+        e = evRing[evTail & EVENTS_RING_MASK];
+        __DMB();
+        evTail = evTail + 1;
+
+        // time, time since the previous event, pin and new level
+        t = fmt_u32(outBfr, e.us);
+        t = fmt_u32(fmt_str(t, " us  +"), e.us - evLastUs);
+        t = fmt_str(fmt_str(t, "  "), getPinName(e.pinNo));
+        fmt_str(t, e.level ? " 1" : " 0");
+        SHOW();
+
+        evLastUs = e.us;
+        n++;
+    }
+
+    return(n);
+}
+
+/**
+  * @name   eventsDropped
+  * @brief  report and clear the dropped count
+  * @param  None
+  * @retval None
+  */
+static void eventsDropped(void)
+{
+    uint32_t        dropped = evDropped - evDroppedShown;
+
+    if ( dropped == 0 )
+        return;
+
+    evDroppedShown += dropped;
+    fmt_str(fmt_u32(outBfr, dropped), " events dropped, journal was full");
+    SHOW();
+}
+
+/**
+  * @name   eventsLiveStep
+  * @brief  'events live' job, shows edges as they arrive
+  * @param  cancel true when a key was pressed
+  * @retval CLI_JOB_RUNNING, or 0 when cancelled
+  */
+static int eventsLiveStep(bool cancel)
+{
+    if ( cancel )
+        return(0);
+
+    if ( eventsShow(EVENTS_LIVE_BATCH) == 0 )
+        eventsDropped();
+
+    return(CLI_JOB_RUNNING);
+}
+
+/**
+  * @name   eventsCmd
+  * @brief  show the GPIO edge journal
+  * @param  cliArgs[0] EVENTS_SHOW (default), EVENTS_CLEAR or EVENTS_LIVE
+  * @retval 0, 1 if 'live' isn't typed at the prompt
+  */
+int eventsCmd(int argCnt)
+{
+    int             subcmd = (argCnt == 0) ? EVENTS_SHOW : cliArgs[0].i;
+
+    switch ( subcmd )
+    {
+        case EVENTS_CLEAR:
+            evTail = evHead;
+            evDroppedShown = evDropped;
+            terminalOut((char *) "Event journal cleared");
+            break;
+
+        case EVENTS_LIVE:
+            // only a key stops it, so not from lists, scripts or frames
+            if ( !cliJobDetached() )
+            {
+                terminalOut((char *) "'events live' only runs at the prompt, use 'events show'");
+                return(1);
+            }
+
+            terminalOut((char *) "Showing events as they happen, hit any key to stop");
+            return(cliJobStart(eventsLiveStep));
+
+        case EVENTS_SHOW:
+        default:
+            if ( eventsShow(EVENTS_RING_SIZE) == 0 )
+                terminalOut((char *) "No events");
+
+            eventsDropped();
+            break;
+    }
+
+    return(0);
+}
@@ -0,0 +1,149 @@
+//===================================================================
+// fmt.cpp
+// Small integer/fixed point formatters.  Each one writes at 'd',
+// NUL terminates and returns a pointer to the terminator so calls
+// can be chained to build a line without sprintf().
+//===================================================================
+#include <Arduino.h>
+#include "fmt.hpp"
+
+const char          fmt_hexDigits[] = "0123456789ABCDEF";
+
+/**
+  * @name   fmt_str
+  * @brief  copy a string
+  * @param  d destination
+  * @param  s string to copy
+  * @retval pointer to terminating NUL in d
+  */
+char *fmt_str(char *d, const char *s)
+{
+    while ( (*d = *s++) != 0 )
+        d++;
+
+    return(d);
+}
+
+/**
+  * @name   fmt_u32
+  * @brief  format unsigned decimal
+  * @param  d destination (at least 11 chars)
+  * @param  v value
+  * @retval pointer to terminating NUL in d
+  */
+char *fmt_u32(char *d, uint32_t v)
+{
+    char            tmp[10];
+    int             n = 0;
+
+    do
+    {
+        tmp[n++] = '0' + (v % 10);
+        v /= 10;
+    } while ( v != 0 );
+
+    while ( n > 0 )
+        *d++ = tmp[--n];
+
+    *d = 0;
+    return(d);
+}
+
+/**
+  * @name   fmt_i32
+  * @brief  format signed decimal
+  * @param  d destination (at least 12 chars)
+  * @param  v value
+  * @retval pointer to terminating NUL in d
+  */
+char *fmt_i32(char *d, int32_t v)
+{
+    if ( v < 0 )
+    {
+        *d++ = '-';
+        return(fmt_u32(d, (uint32_t) 0 - (uint32_t) v));
+    }
+
+    return(fmt_u32(d, (uint32_t) v));
+}
+
+/**
+  * @name   fmt_hex
+  * @brief  format fixed width upper case hex
+  * @param  d destination (at least digits + 1 chars)
+  * @param  v value
+  * @param  digits number of hex digits, 1..8
+  * @retval pointer to terminating NUL in d
+  */
+char *fmt_hex(char *d, uint32_t v, uint8_t digits)
+{
+    char            *end = d + digits;
+
+    *end = 0;
+
+    while ( digits-- > 0 )
+    {
+        d[digits] = fmt_hexDigits[v & 0xF];
+        v >>= 4;
+    }
+
+    return(end);
+}
+
+/**
+  * @name   fmt_milli
+  * @brief  format a value in thousandths as a fixed point number
+  * @param  d destination (at least width + 13 chars)
+  * @param  milli value x 1000, e.g. millivolts to show volts
+  * @param  decimals digits after the point, 0..3 (rounded)
+  * @param  width minimum field width, right justified like "%5.2f"
+  * @retval pointer to terminating NUL in d
+  */
+char *fmt_milli(char *d, int32_t milli, uint8_t decimals, uint8_t width)
+{
+    static const uint16_t   scale[4] = {1000, 100, 10, 1};
+    char            tmp[16];
+    char            *s = tmp;
+    uint32_t        v;
+    uint16_t        div;
+    int             len;
+
+    if ( decimals > 3 )
+        decimals = 3;
+
+    div = scale[decimals];
+
+    if ( milli < 0 )
+    {
+        *s++ = '-';
+        v = (uint32_t) 0 - (uint32_t) milli;
+    }
+    else
+    {
+        v = (uint32_t) milli;
+    }
+
+    // round to the number of decimals kept, then split whole/fraction
+    v = (v + div / 2) / div;
+    div = scale[3 - decimals];
+
+    s = fmt_u32(s, v / div);
+
+    if ( decimals )
+    {
+        v %= div;
+        *s++ = '.';
+        while ( div > 1 )
+        {
+            div /= 10;
+            *s++ = '0' + (v / div) % 10;
+        }
+        *s = 0;
+    }
+
+    len = s - tmp;
+    while ( len++ < width )
+        *d++ = ' ';
+
+    return(fmt_str(d, tmp));
+}
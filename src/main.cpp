@@ -7,6 +7,11 @@
 #include "commands.hpp"
 #include "eeprom.hpp"
 #include "cli.hpp"
+#include "script.hpp"
+#include "proto.hpp"
+#include "sched.hpp"
+#include "presence.hpp"
+#include "events.hpp"
 
 // timers
 void timers_Init(void);
@@ -15,6 +20,38 @@ void timers_Init(void);
 #define FAST_BLINK_DELAY            200
 #define SLOW_BLINK_DELAY            1000
 
+/**
+  * @name   heartbeat
+  * @brief  toggle the heartbeat LED
+  * @param  None
+  * @retval None
+  * @note   scheduled task
+  */
+static void heartbeat(void)
+{
+  static bool     LEDstate = false;
+
+  LEDstate = LEDstate ? 0 : 1;
+  digitalWrite(PIN_LED, LEDstate);
+}
+
+/**
+  * @name   serviceBackground
+  * @brief  send queued output and run due background tasks
+  * @param  None
+  * @retval None
+  * @note   called from loop(), and by the CLI while a command keeps
+  *         it from returning to loop() (inline jobs, repeat waits)
+  */
+void serviceBackground(void)
+{
+  // push any queued terminal output to the host
+  term_service();
+
+  // heartbeat LED, card presence, autorun script on card insertion, etc.
+  sched_run();
+}
+
 /**
   * @name   setup
   * @brief  system initialization
@@ -32,12 +69,13 @@ void setup()
   digitalWrite(PIN_LED, LOW);
   readAllPins();
 
-  // disable main & aux power to NIC 3.0 card
-  writePin(OCP_MAIN_PWR_EN, 0);
-  writePin(OCP_AUX_PWR_EN, 0);
+  // track card presence from the PRSNTB pins, journal input edges
+  presence_Init();
+  events_Init();
 
-  // deassert PHY reset
-  writePin(PHY_RESET_N, 1);
+  // disable main & aux power to NIC 3.0 card and
+  // deassert PHY reset, all at once
+  writePinMask(pinGroupBits(PIN_GROUP_CARD), pinBit(PHY_RESET_N));
 
   // init timers for scan chain clock
   timers_Init();
@@ -48,6 +86,10 @@ void setup()
   // NOTE: Baud rate isn't applicable to USB...
   SerialUSB.begin(115200);
 
+  // background tasks, run from loop() once the host is connected
+  sched_add("heartbeat", heartbeat, SLOW_BLINK_DELAY, 0);
+  sched_add("autorun", script_service, SCRIPT_PRESENCE_POLL_MS, 0);
+
 } // setup()
 
 
@@ -60,13 +102,7 @@ void setup()
   */
 void loop() 
 {
-  int             byteIn;
   static char     inBfr[MAX_LINE_SZ];
-  static int      inCharCount = 0;
-  static char     lastCmd[80] = "help";
-  const char      bs[4] = {0x1b, '[', '1', 'D'};  // terminal: backspace seq
-  static bool     LEDstate = false;
-  static uint32_t time = millis();
   static bool     isFirstTime = true;
 
   if ( isFirstTime )
@@ -75,10 +111,10 @@ void loop()
     {
         doHello();
         EEPROM_InitLocal();
+        script_Init();
         terminalOut((char *) "Press ENTER if prompt is not shown");
         doPrompt();
         isFirstTime = false;
-        time = millis();
     }
     else
     {
@@ -88,89 +124,23 @@ void loop()
   }
   else
   {
-        // blink heartbeat LED
-        if ( millis() - time >= SLOW_BLINK_DELAY )
-        {
-            time = millis();
-            LEDstate = LEDstate ? 0 : 1;
-            digitalWrite(PIN_LED, LEDstate);
-        }
+        serviceBackground();
   }
 
-  // process incoming serial over USB characters
-  if ( SerialUSB.available() )
+  // step a long running command, else binary protocol frames when in
+  // that mode, else assemble incoming serial over USB characters into
+  // a line and run it
+  if ( cliJobService() )
   {
-      byteIn = SerialUSB.read();
-      if ( byteIn == 0x0a )
-      {
-          // line feed - echo it
-          SerialUSB.write(0x0a);
-          SerialUSB.flush();
-      }
-      else if ( byteIn == 0x0d )
-      {
-          // carriage return - EOL 
-          // save as the last cmd (for up arrow) and call CLI with
-          // the completed line less CR/LF
-          terminalOut((char *) " ");
-          inBfr[inCharCount] = 0;
-          inCharCount = 0;
-          strcpy(lastCmd, inBfr);
-          cli(inBfr);
-          SerialUSB.flush();
-      }
-      else if ( byteIn == 0x1b )
-      {
-          // handle ANSI escape sequence - only UP arrow is supported
-          if ( SerialUSB.available() )
-          {
-              byteIn = SerialUSB.read();
-              if ( byteIn == '[' )
-              {
-                if ( SerialUSB.available() )
-                {
-                    byteIn = SerialUSB.read();
-                    if ( byteIn == 'A' )
-                    {
-                        // up arrow: echo last command entered then execute in CLI
-                        terminalOut(lastCmd);
-                        SerialUSB.flush();
-                        cli(lastCmd);
-                        SerialUSB.flush();
-                    }
-                }
-            }
-        }
-    }
-    else if ( byteIn == 127 || byteIn == 8 )
-    {
-        // delete & backspace do the same thing which is erase last char entered
-        // and backspace once
-        if ( inCharCount )
-        {
-            inBfr[inCharCount--] = 0;
-            SerialUSB.write(bs, 4);
-            SerialUSB.write(' ');
-            SerialUSB.write(bs, 4);
-            SerialUSB.flush();
-        }
-    }
-    else
-    {
-        // all other keys get echoed & stored in buffer
-        SerialUSB.write((char) byteIn);
-        SerialUSB.flush();
-        inBfr[inCharCount] = byteIn;
-        if ( inCharCount < (MAX_LINE_SZ-1) )
-        {
-            inCharCount++;
-        }
-        else
-        {
-            terminalOut((char *) "Serial input buffer overflow!");
-            inCharCount = 0;
-        }
-    }
+      // command job owns the input, any key cancels it
+  }
+  else if ( proto_service() )
+  {
+      // binary protocol owns the input
+  }
+  else if ( term_getLine(inBfr, sizeof(inBfr)) )
+  {
+      cli(inBfr);
   }
 
 } // loop()
@@ -0,0 +1,146 @@
+//===================================================================
+// perf.cpp
+// Latency instrumentation.  Every command dispatched by the CLI is
+// timed along with the terminal output it produced, and probe points
+// in the hot paths time the low level operations under them.  Times
+// are micros() deltas so include any interrupt time; 'xdebug perf'
+// shows the results and 'xdebug perf reset' clears them.
+//
+// Usage for a probe point:
+//     uint32_t start = micros();
+//     ... work ...
+//     perf_probe(PERF_xxx, start);
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "perf.hpp"
+
+static char             outBfr[OUTBFR_SIZE];
+
+static perf_stat_t      cmdStats[PERF_CMD_MAX];
+static perf_stat_t      probeStats[PERF_PROBE_CNT];
+
+// list order must match perf_probe_t
+static const char       *perfProbeNames[PERF_PROBE_CNT] = {
+    "eeprom read",
+    "scan capture",
+    "ina219 read",
+    "usb send",
+};
+
+/**
+  * @name   perfAdd
+  * @brief  add one sample to a stat
+  * @param  stat stat to update
+  * @param  us duration in usecs
+  * @retval None
+  */
+static void perfAdd(perf_stat_t *stat, uint32_t us)
+{
+    if ( stat->count == 0 || us < stat->minUs )
+        stat->minUs = us;
+
+    if ( us > stat->maxUs )
+        stat->maxUs = us;
+
+    stat->totalUs += us;
+    stat->count++;
+}
+
+/**
+  * @name   perf_cmdRecord
+  * @brief  record one command dispatch
+  * @param  cmd command table index
+  * @param  startUs micros() when the command started
+  * @param  bytes terminal output bytes the command produced
+  * @retval None
+  * @note   nested commands (e.g. under 'repeat') are also counted
+  *         in the outer command's time and bytes
+  * @note   a command that starts a job is recorded when the job ends,
+  *         wherever it ran, so its time is the whole job; output from
+  *         background work while a job runs at the prompt counts too
+  */
+void perf_cmdRecord(int cmd, uint32_t startUs, uint32_t bytes)
+{
+    uint32_t        us = micros() - startUs;
+
+    if ( cmd < 0 || cmd >= PERF_CMD_MAX )
+        return;
+
+    perfAdd(&cmdStats[cmd], us);
+    cmdStats[cmd].bytes += bytes;
+}
+
+/**
+  * @name   perf_probe
+  * @brief  record one pass through a probe point
+  * @param  probe which probe
+  * @param  startUs micros() when the probed code started
+  * @retval None
+  */
+void perf_probe(perf_probe_t probe, uint32_t startUs)
+{
+    perfAdd(&probeStats[probe], micros() - startUs);
+}
+
+/**
+  * @name   perf_reset
+  * @brief  clear all stats
+  * @param  None
+  * @retval None
+  */
+void perf_reset(void)
+{
+    memset(cmdStats, 0, sizeof(cmdStats));
+    memset(probeStats, 0, sizeof(probeStats));
+}
+
+/**
+  * @name   perfShowStat
+  * @brief  display one stats line
+  * @param  name what was measured
+  * @param  stat its stats
+  * @param  bytes true to include the bytes column
+  * @retval None
+  */
+static void perfShowStat(const char *name, const perf_stat_t *stat, bool bytes)
+{
+    int             n;
+
+    n = sprintf(outBfr, "%-13s %8lu %8lu %8lu %8lu", name, (unsigned long) stat->count,
+                (unsigned long) stat->minUs, (unsigned long) (stat->totalUs / stat->count),
+                (unsigned long) stat->maxUs);
+
+    if ( bytes )
+        sprintf(&outBfr[n], " %8lu", (unsigned long) stat->bytes);
+
+    SHOW();
+}
+
+/**
+  * @name   perf_show
+  * @brief  display command and probe stats
+  * @param  None
+  * @retval None
+  * @note   entries that haven't run since the last reset are skipped
+  */
+void perf_show(void)
+{
+    const char      *name;
+
+    terminalOut((char *) "Command          count   min us   avg us   max us    bytes");
+
+    for ( int i = 0; i < PERF_CMD_MAX && (name = cliCommandName(i)) != NULL; i++ )
+    {
+        if ( cmdStats[i].count )
+            perfShowStat(name, &cmdStats[i], true);
+    }
+
+    terminalOut((char *) "Probe            count   min us   avg us   max us");
+
+    for ( int i = 0; i < PERF_PROBE_CNT; i++ )
+    {
+        if ( probeStats[i].count )
+            perfShowStat(perfProbeNames[i], &probeStats[i], false);
+    }
+}
@@ -0,0 +1,191 @@
+//===================================================================
+// presence.cpp
+// NIC card presence tracking.  The PRSNTB[3:0] pins interrupt on any
+// edge through the EIC; the ISR only notes the time, and a scheduled
+// task samples the pins once they have been quiet for the debounce
+// time.  The result is kept in cardPresence so a presence check is a
+// single load, and insertions and removals are reported to the host
+// as they happen.  The CLI runs background tasks while a command
+// keeps loop() busy, see serviceBackground(), so this stays current
+// under lists, repeat, scripts and inline jobs too.
+//
+// PRSNTB0 (PA18) and PRSNTB3 (PB02) share EXTINT2, so only PRSNTB3
+// has an interrupt; the task also resamples every PRESENCE_BACKSTOP_MS
+// so a change seen only on PRSNTB0 is still picked up.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "commands.hpp"
+#include "presence.hpp"
+#include "proto.hpp"
+#include "sched.hpp"
+#include "events.hpp"
+
+static char             outBfr[OUTBFR_SIZE];
+
+presence_t              cardPresence = { false, PRSNTB_NONE, 0, 0 };
+
+// PRSNTB[3:0] in bit order
+static const uint8_t    prsntbPins[4] = { OCP_PRSNTB0_N, OCP_PRSNTB1_N, OCP_PRSNTB2_N, OCP_PRSNTB3_N };
+
+// set by the ISR, cleared by the task
+static volatile bool     edgeSeen = false;
+static volatile uint32_t edgeMs;
+
+static uint8_t          candidate = 0xFF;     // changed PRSNTB waiting for a second read
+static uint32_t         lastSampleMs;
+
+/**
+  * @name   presenceEdge
+  * @brief  EIC handler for the PRSNTB pins
+  * @param  None
+  * @retval None
+  * @note   each bounce restarts the debounce time; the edge also
+  *         goes in the event journal
+  */
+template <uint8_t PIN>
+static void presenceEdge(void)
+{
+    edgeMs = millis();
+    edgeSeen = true;
+    events_record(PIN);
+}
+
+/**
+  * @name   presenceSample
+  * @brief  read PRSNTB[3:0]
+  * @param  None
+  * @retval pin levels, bit n is PRSNTBn
+  */
+static uint8_t presenceSample(void)
+{
+    uint32_t        in[2];
+    uint8_t         prsntb = 0;
+    uint8_t         port;
+    uint32_t        mask;
+
+    in[PORTA] = PORT->Group[PORTA].IN.reg;
+    in[PORTB] = PORT->Group[PORTB].IN.reg;
+
+    for ( int i = 0; i < 4; i++ )
+    {
+        mask = getPinPortMask(getPinIndex(prsntbPins[i]), &port);
+        if ( in[port] & mask )
+            prsntb |= 1 << i;
+    }
+
+    return(prsntb);
+}
+
+/**
+  * @name   presenceReport
+  * @brief  tell the host about an insertion or removal
+  * @param  None
+  * @retval None
+  * @note   a PROTO_EVT_PRESENCE frame in binary mode, else a text
+  *         line unless a command job (e.g. the status screen) owns
+  *         the terminal
+  */
+static void presenceReport(void)
+{
+    uint8_t         data[6];
+
+    data[0] = cardPresence.present;
+    data[1] = cardPresence.prsntb;
+    for ( int i = 0; i < 4; i++ )
+        data[2 + i] = cardPresence.insertedMs >> (i * 8);
+
+    if ( proto_event(PROTO_EVT_PRESENCE, data, sizeof(data)) || cliJobActive() )
+        return;
+
+    if ( cardPresence.present )
+        sprintf(outBfr, "\r\nCard inserted, PRSNTB[3:0] = 0x%X", cardPresence.prsntb);
+    else
+        sprintf(outBfr, "\r\nCard removed");
+
+    SHOW();
+
+    // mid-command the command's own output carries on instead
+    if ( !cliCommandRunning() )
+        doPrompt();
+}
+
+/**
+  * @name   presenceTask
+  * @brief  debounce PRSNTB changes into cardPresence
+  * @param  None
+  * @retval None
+  * @note   scheduled task; a change has to read the same twice, a
+  *         debounce time apart, with no edges in between
+  */
+static void presenceTask(void)
+{
+    uint32_t        now = millis();
+    uint8_t         prsntb;
+
+    if ( edgeSeen )
+    {
+        if ( now - edgeMs < PRESENCE_DEBOUNCE_MS )
+            return;
+    }
+    else if ( now - lastSampleMs < PRESENCE_BACKSTOP_MS )
+    {
+        return;
+    }
+
+    // clear first so an edge during the sample isn't lost
+    edgeSeen = false;
+    lastSampleMs = now;
+    prsntb = presenceSample();
+
+    if ( prsntb == cardPresence.prsntb )
+    {
+        candidate = 0xFF;
+        return;
+    }
+
+    if ( prsntb != candidate )
+    {
+        // read it again after the debounce time
+        candidate = prsntb;
+        edgeMs = now;
+        edgeSeen = true;
+        return;
+    }
+
+    candidate = 0xFF;
+    cardPresence.prsntb = prsntb;
+
+    if ( (prsntb != PRSNTB_NONE) != cardPresence.present )
+    {
+        cardPresence.present = (prsntb != PRSNTB_NONE);
+        if ( cardPresence.present )
+            cardPresence.insertedMs = now;
+
+        cardPresence.changes++;
+        presenceReport();
+    }
+}
+
+/**
+  * @name   presence_Init
+  * @brief  take the initial card state and start tracking
+  * @param  None
+  * @retval None
+  * @note   call after the pins are configured; a card present at
+  *         startup counts as inserted at that time
+  */
+void presence_Init(void)
+{
+    cardPresence.prsntb = presenceSample();
+    cardPresence.present = (cardPresence.prsntb != PRSNTB_NONE);
+    cardPresence.insertedMs = millis();
+    lastSampleMs = millis();
+
+    // PRSNTB0 has no EXTINT line of its own, see above
+    attachInterrupt(digitalPinToInterrupt(OCP_PRSNTB1_N), presenceEdge<OCP_PRSNTB1_N>, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(OCP_PRSNTB2_N), presenceEdge<OCP_PRSNTB2_N>, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(OCP_PRSNTB3_N), presenceEdge<OCP_PRSNTB3_N>, CHANGE);
+
+    sched_add("presence", presenceTask, PRESENCE_TASK_MS, 0);
+}
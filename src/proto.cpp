@@ -0,0 +1,440 @@
+//===================================================================
+// proto.cpp
+// Binary framed machine protocol.  Requests carry an id so a host
+// can send several without waiting; each gets zero or more output
+// frames and then a done frame with a status, all tagged with its id.
+// Text and bytecode requests run through the same command handlers
+// as the CLI with their terminal output captured into frames.
+//
+// Binary mode is entered with 'mode binary' or by sending a 0x00
+// frame delimiter (any text typed before it is dropped), and left with a
+// PROTO_REQ_TEXT_MODE request or 'mode text'.  Interactive commands
+// such as 'status' wait for a keypress and aren't useful here.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "commands.hpp"
+#include "proto.hpp"
+
+extern uint8_t          pinStates[];
+extern uint16_t         static_pin_count;
+
+// COBS adds one byte per 254 plus the leading code byte
+#define PROTO_ENC_MAX             (PROTO_FRAME_MAX + PROTO_FRAME_MAX / 254 + 1)
+
+typedef enum {
+    PROTO_OFF = 0,
+    PROTO_PENDING,          // 'mode binary' seen, switch after the prompt
+    PROTO_ON,
+
+} proto_state_t;
+
+static proto_state_t    protoState = PROTO_OFF;
+static bool             protoLeave = false;
+
+// received frame, COBS encoded until the delimiter, then decoded in place
+static uint8_t          rxFrame[PROTO_ENC_MAX];
+static uint16_t         rxLen = 0;
+static bool             rxOverflow = false;
+
+// captured command output for the current request
+static uint8_t          outChunk[PROTO_OUT_CHUNK];
+static uint16_t         outLen = 0;
+static uint8_t          outId = 0;
+
+// CRC-16/CCITT-FALSE, a nibble at a time
+static const uint16_t   crcNibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+/**
+  * @name   protoCrc
+  * @brief  CRC-16/CCITT-FALSE
+  * @param  p data
+  * @param  len bytes of data
+  * @retval CRC
+  */
+static uint16_t protoCrc(const uint8_t *p, uint16_t len)
+{
+    uint16_t        crc = 0xFFFF;
+
+    while ( len-- > 0 )
+    {
+        crc = (crc << 4) ^ crcNibble[(crc >> 12) ^ (*p >> 4)];
+        crc = (crc << 4) ^ crcNibble[(crc >> 12) ^ (*p & 0x0F)];
+        p++;
+    }
+
+    return(crc);
+}
+
+/**
+  * @name   protoDecode
+  * @brief  COBS decode a frame in place
+  * @param  p encoded frame without the delimiter
+  * @param  len encoded length
+  * @retval decoded length, -1 if malformed
+  * @note   decoded data is never longer than encoded, so in place works
+  */
+static int protoDecode(uint8_t *p, uint16_t len)
+{
+    const uint8_t   *src = p;
+    const uint8_t   *end = p + len;
+    uint8_t         *dst = p;
+    uint8_t         code;
+
+    while ( src < end )
+    {
+        code = *src++;
+        if ( code == 0 || code - 1 > end - src )
+            return(-1);
+
+        for ( int i = 1; i < code; i++ )
+            *dst++ = *src++;
+
+        if ( code != 0xFF && src < end )
+            *dst++ = 0;
+    }
+
+    return(dst - p);
+}
+
+/**
+  * @name   protoSend
+  * @brief  send one frame
+  * @param  type response type
+  * @param  id request id
+  * @param  status first payload byte, -1 for none
+  * @param  data rest of the payload
+  * @param  len bytes of data
+  * @retval None
+  */
+static void protoSend(uint8_t type, uint8_t id, int status, const uint8_t *data, uint16_t len)
+{
+    uint8_t         frame[PROTO_FRAME_MAX];
+    uint8_t         enc[PROTO_ENC_MAX + 1];
+    uint8_t         *f = frame;
+    uint16_t        crc;
+    uint8_t         *code;
+    uint8_t         *e;
+
+    *f++ = type;
+    *f++ = id;
+    if ( status >= 0 )
+        *f++ = status;
+
+    if ( len > PROTO_FRAME_MAX - 2 - (f - frame) )
+        len = PROTO_FRAME_MAX - 2 - (f - frame);
+
+    memcpy(f, data, len);
+    f += len;
+
+    crc = protoCrc(frame, f - frame);
+    *f++ = crc;
+    *f++ = crc >> 8;
+
+    // COBS encode, each code byte is the distance to the next zero
+    code = enc;
+    e = enc + 1;
+    for ( uint8_t *p = frame; p < f; p++ )
+    {
+        if ( *p != 0 )
+            *e++ = *p;
+
+        if ( *p == 0 || e - code == 0xFF )
+        {
+            *code = e - code;
+            code = e++;
+        }
+    }
+    *code = e - code;
+    *e++ = PROTO_DELIM;
+
+    term_writeRaw((const char *) enc, e - enc);
+}
+
+/**
+  * @name   protoFlushOutput
+  * @brief  send captured output as a PROTO_RSP_OUTPUT frame
+  * @param  None
+  * @retval None
+  */
+static void protoFlushOutput(void)
+{
+    if ( outLen == 0 )
+        return;
+
+    protoSend(PROTO_RSP_OUTPUT, outId, -1, outChunk, outLen);
+    outLen = 0;
+}
+
+/**
+  * @name   protoOutput
+  * @brief  terminal output sink while a request runs
+  * @param  s output bytes
+  * @param  len number of bytes
+  * @retval None
+  */
+static void protoOutput(const char *s, uint16_t len)
+{
+    uint16_t        n;
+
+    while ( len > 0 )
+    {
+        n = PROTO_OUT_CHUNK - outLen;
+        if ( n > len )
+            n = len;
+
+        memcpy(&outChunk[outLen], s, n);
+        outLen += n;
+        s += n;
+        len -= n;
+
+        if ( outLen == PROTO_OUT_CHUNK )
+            protoFlushOutput();
+    }
+}
+
+/**
+  * @name   protoPut32
+  * @brief  store a 32 bit value little endian
+  * @param  p where to store
+  * @param  v value
+  * @retval pointer past the value
+  */
+static uint8_t *protoPut32(uint8_t *p, uint32_t v)
+{
+    for ( int b = 0; b < 32; b += 8 )
+        *p++ = v >> b;
+
+    return(p);
+}
+
+/**
+  * @name   protoHandle
+  * @brief  check and run one decoded request frame
+  * @param  f frame
+  * @param  len frame length
+  * @retval None
+  */
+static void protoHandle(uint8_t *f, int len)
+{
+    uint8_t         data[20];
+    uint8_t         *d = data;
+    char            line[MAX_LINE_SZ];
+    uint8_t         id = (len >= 2) ? f[1] : 0;
+    uint8_t         *body = f + 2;
+    int             bodyLen = len - 4;
+    int             status = PROTO_OK;
+    bool            ok = true;
+    int32_t         rails[4];
+    uint32_t        levels = 0;
+
+    if ( len < 4 || protoCrc(f, len - 2) != (f[len - 2] | (f[len - 1] << 8)) )
+    {
+        protoSend(PROTO_RSP_DONE, id, PROTO_ERR_CRC, NULL, 0);
+        return;
+    }
+
+    outId = id;
+
+    switch ( f[0] )
+    {
+        case PROTO_REQ_TEXT:
+        case PROTO_REQ_CODE:
+            term_setSink(protoOutput);
+
+            if ( f[0] == PROTO_REQ_TEXT )
+            {
+                if ( bodyLen > MAX_LINE_SZ - 1 )
+                    bodyLen = MAX_LINE_SZ - 1;
+
+                memcpy(line, body, bodyLen);
+                line[bodyLen] = 0;
+                ok = cliLine(line);
+            }
+            else
+            {
+                // string args point into the frame buffer while it runs
+                ok = cliRunCode(body, bodyLen);
+            }
+
+            term_bulkFlush();
+            term_setSink(NULL);
+            protoFlushOutput();
+
+            status = !ok ? PROTO_ERR_REJECTED : cliLastStatus() ? PROTO_ERR_CMD : PROTO_OK;
+            break;
+
+        case PROTO_REQ_RAILS:
+            get12VData(&rails[0], &rails[1]);
+            get3P3VData(&rails[2], &rails[3]);
+
+            for ( int i = 0; i < 4; i++ )
+                d = protoPut32(d, rails[i]);
+            break;
+
+        case PROTO_REQ_PINS:
+            readAllPins();
+
+            for ( int i = 0; i < static_pin_count && i < 32; i++ )
+                levels |= (uint32_t) (pinStates[i] ? 1 : 0) << i;
+
+            *d++ = static_pin_count;
+            d = protoPut32(d, levels);
+            break;
+
+        case PROTO_REQ_SCAN:
+            d = protoPut32(d, queryScanChain(false));
+            break;
+
+        case PROTO_REQ_PRESENT:
+            *d++ = isCardPresent() ? 1 : 0;
+            break;
+
+        case PROTO_REQ_TEXT_MODE:
+            protoLeave = true;
+            break;
+
+        default:
+            status = PROTO_ERR_TYPE;
+            break;
+    }
+
+    protoSend(PROTO_RSP_DONE, id, status, data, d - data);
+}
+
+/**
+  * @name   proto_service
+  * @brief  handle received frames while in binary mode
+  * @param  None
+  * @retval true if binary mode owns the input, else false
+  * @note   called from loop() ahead of the text CLI; handles at most
+  *         one request per call
+  */
+bool proto_service(void)
+{
+    int             byteIn;
+    int             len;
+
+    if ( protoState == PROTO_OFF )
+    {
+        // a frame delimiter switches modes; a partly typed line is
+        // dropped so it doesn't run when text mode comes back
+        if ( term_peek() != PROTO_DELIM )
+            return(false);
+
+        (void) term_getc();
+        term_lineFlush();
+        protoState = PROTO_PENDING;
+    }
+
+    if ( protoState == PROTO_PENDING )
+    {
+        // a delimiter lets the host sync to the first frame
+        term_writeRaw("\x00", 1);
+        protoState = PROTO_ON;
+        rxLen = 0;
+        rxOverflow = false;
+    }
+
+    while ( (byteIn = term_getc()) >= 0 )
+    {
+        if ( byteIn != PROTO_DELIM )
+        {
+            if ( rxLen < sizeof(rxFrame) )
+                rxFrame[rxLen++] = byteIn;
+            else
+                rxOverflow = true;
+
+            continue;
+        }
+
+        // empty frames are just resync delimiters
+        if ( rxOverflow )
+        {
+            protoSend(PROTO_RSP_DONE, 0, PROTO_ERR_LENGTH, NULL, 0);
+        }
+        else if ( rxLen > 0 )
+        {
+            len = protoDecode(rxFrame, rxLen);
+            if ( len < 0 )
+                protoSend(PROTO_RSP_DONE, 0, PROTO_ERR_CRC, NULL, 0);
+            else
+                protoHandle(rxFrame, len);
+        }
+
+        rxLen = 0;
+        rxOverflow = false;
+
+        if ( protoLeave )
+        {
+            protoLeave = false;
+            protoState = PROTO_OFF;
+            doPrompt();
+        }
+
+        break;
+    }
+
+    return(true);
+}
+
+/**
+  * @name   proto_active
+  * @brief  check if the binary protocol owns the terminal
+  * @param  None
+  * @retval true in binary mode or about to enter it
+  */
+bool proto_active(void)
+{
+    return(protoState != PROTO_OFF);
+}
+
+/**
+  * @name   proto_event
+  * @brief  send an unsolicited event frame
+  * @param  type PROTO_EVT_xxx
+  * @param  data payload
+  * @param  len bytes of payload
+  * @retval true if sent, false if not in binary mode
+  */
+bool proto_event(uint8_t type, const uint8_t *data, uint16_t len)
+{
+    if ( protoState != PROTO_ON )
+        return(false);
+
+    protoSend(type, 0, -1, data, len);
+    return(true);
+}
+
+/**
+  * @name   modeCmd
+  * @brief  switch between the text CLI and the binary protocol
+  * @param  cliArgs[0] PROTO_MODE_BINARY or PROTO_MODE_TEXT
+  * @retval 0
+  */
+int modeCmd(int argCnt)
+{
+    if ( argCnt == 0 )
+    {
+        terminalOut((char *) ((protoState == PROTO_ON) ? "Mode: binary" : "Mode: text"));
+        return(0);
+    }
+
+    if ( cliArgs[0].i == PROTO_MODE_BINARY )
+    {
+        if ( protoState == PROTO_OFF )
+        {
+            terminalOut((char *) "Entering binary protocol mode");
+            protoState = PROTO_PENDING;
+        }
+    }
+    else if ( protoState == PROTO_ON )
+    {
+        protoLeave = true;
+    }
+
+    return(0);
+}
@@ -0,0 +1,181 @@
+//===================================================================
+// sched.cpp
+// Cooperative scheduler for background work.  Tasks live in a fixed
+// table and are either periodic or one-shot; sched_run() is called
+// from loop() and runs the most overdue task, at most one per call,
+// so input and terminal output are serviced between tasks.  The
+// timebase is millis() (SysTick).  Each task's run count, lateness
+// and run time are kept for 'xdebug tasks'.
+//
+// Periodic tasks are kept at a fixed rate; one that falls a whole
+// period behind is resynced instead of being run back to back.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "sched.hpp"
+
+static char             outBfr[OUTBFR_SIZE];
+
+typedef struct {
+    const char      *name;
+    sched_func_t    func;
+    uint32_t        periodMs;             // 0 for one-shot
+    uint32_t        due;                  // millis() when next due
+    bool            active;
+    uint32_t        runs;
+    uint32_t        lateMaxMs;
+    uint64_t        totalUs;
+    uint32_t        maxUs;
+
+} sched_task_t;
+
+static sched_task_t     tasks[SCHED_TASK_MAX];
+static uint8_t          taskCnt = 0;
+
+/**
+  * @name   sched_add
+  * @brief  add a task to the table
+  * @param  name shown by sched_show()
+  * @param  func task function
+  * @param  periodMs run every periodMs, 0 to run once
+  * @param  delayMs first run delayMs from now
+  * @retval task id, -1 if the table is full
+  * @note   a finished one-shot keeps its slot, see sched_start()
+  */
+int sched_add(const char *name, sched_func_t func, uint32_t periodMs, uint32_t delayMs)
+{
+    sched_task_t    *t = &tasks[taskCnt];
+
+    if ( taskCnt >= SCHED_TASK_MAX )
+        return(-1);
+
+    memset(t, 0, sizeof(sched_task_t));
+    t->name = name;
+    t->func = func;
+    t->periodMs = periodMs;
+    t->due = millis() + delayMs;
+    t->active = true;
+
+    return(taskCnt++);
+}
+
+/**
+  * @name   sched_start
+  * @brief  (re)start a task
+  * @param  id task id from sched_add()
+  * @param  delayMs run delayMs from now
+  * @retval None
+  */
+void sched_start(int id, uint32_t delayMs)
+{
+    if ( id < 0 || id >= taskCnt )
+        return;
+
+    tasks[id].due = millis() + delayMs;
+    tasks[id].active = true;
+}
+
+/**
+  * @name   sched_stop
+  * @brief  stop a task until it is started again
+  * @param  id task id from sched_add()
+  * @retval None
+  */
+void sched_stop(int id)
+{
+    if ( id >= 0 && id < taskCnt )
+        tasks[id].active = false;
+}
+
+/**
+  * @name   sched_run
+  * @brief  run the most overdue task, if any is due
+  * @param  None
+  * @retval None
+  * @note   called from loop(); ties go to the earlier table entry
+  */
+void sched_run(void)
+{
+    uint32_t        now = millis();
+    sched_task_t    *next = NULL;
+    sched_task_t    *t;
+    uint32_t        late;
+    uint32_t        lateMost = 0;
+    uint32_t        start;
+    uint32_t        us;
+
+    for ( t = tasks; t < &tasks[taskCnt]; t++ )
+    {
+        // signed difference so the millis() wrap doesn't matter
+        if ( !t->active || (int32_t) (now - t->due) < 0 )
+            continue;
+
+        late = now - t->due;
+        if ( next == NULL || late > lateMost )
+        {
+            next = t;
+            lateMost = late;
+        }
+    }
+
+    if ( next == NULL )
+        return;
+
+    // set up the next run first so a task can stop or restart itself
+    if ( next->periodMs == 0 )
+        next->active = false;
+    else if ( lateMost >= next->periodMs )
+        next->due = now + next->periodMs;
+    else
+        next->due += next->periodMs;
+
+    start = micros();
+    (next->func) ();
+    us = micros() - start;
+
+    next->runs++;
+    next->totalUs += us;
+    if ( us > next->maxUs )
+        next->maxUs = us;
+    if ( lateMost > next->lateMaxMs )
+        next->lateMaxMs = lateMost;
+}
+
+/**
+  * @name   sched_reset
+  * @brief  clear the task stats
+  * @param  None
+  * @retval None
+  */
+void sched_reset(void)
+{
+    for ( int i = 0; i < taskCnt; i++ )
+    {
+        tasks[i].runs = 0;
+        tasks[i].lateMaxMs = 0;
+        tasks[i].totalUs = 0;
+        tasks[i].maxUs = 0;
+    }
+}
+
+/**
+  * @name   sched_show
+  * @brief  display the task table and stats
+  * @param  None
+  * @retval None
+  */
+void sched_show(void)
+{
+    sched_task_t    *t;
+
+    terminalOut((char *) "Task         period     runs  late ms   avg us   max us");
+
+    for ( t = tasks; t < &tasks[taskCnt]; t++ )
+    {
+        sprintf(outBfr, "%-10s %8lu %8lu %8lu %8lu %8lu%s", t->name, (unsigned long) t->periodMs,
+                (unsigned long) t->runs, (unsigned long) t->lateMaxMs,
+                (unsigned long) (t->runs ? t->totalUs / t->runs : 0), (unsigned long) t->maxUs,
+                t->active ? "" : " (stopped)");
+        SHOW();
+    }
+}
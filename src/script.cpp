@@ -0,0 +1,426 @@
+//===================================================================
+// script.cpp
+// Stored command scripts.  Named command sequences are compiled once
+// by cliCompile() when they are entered and kept as bytecode in the
+// simulated EEPROM (FLASH), so 'run <name>' and the autorun on card
+// insertion execute them without re-tokenizing.  The store shares the
+// one EEPROM object in eeprom.cpp through its EEPROM_xxx() accessors,
+// after EEPROM_data_t.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "eeprom.hpp"
+#include "commands.hpp"
+#include "script.hpp"
+#include "proto.hpp"
+#include "fmt.hpp"
+
+static_assert(sizeof(EEPROM_data_t) <= SCRIPT_STORE_ADDR, "EEPROM_data_t overlaps the script store");
+
+#define SCRIPT_SIGNATURE          0x5C121D01
+#define SCRIPT_RECORDS_ADDR       (SCRIPT_STORE_ADDR + sizeof(script_hdr_t))
+#define SCRIPT_RECORD_MAX         (1 + SCRIPT_NAME_MAX + SCRIPT_CODE_MAX)
+
+static_assert(SCRIPT_RECORD_MAX <= 255, "script record length must fit in a byte");
+
+static char             outBfr[OUTBFR_SIZE];
+static script_hdr_t     scriptHdr;
+
+/**
+  * @name   scriptReadName
+  * @brief  get the name of the script record at addr
+  * @param  addr EEPROM address of the record
+  * @param  name where to copy the name, SCRIPT_NAME_MAX bytes
+  * @retval None
+  */
+static void scriptReadName(uint16_t addr, char *name)
+{
+    int             i = 0;
+
+    addr++;
+    while ( i < SCRIPT_NAME_MAX - 1 )
+    {
+        EEPROM_readBlock(addr++, &name[i], 1);
+        if ( name[i] == 0 )
+            break;
+        i++;
+    }
+
+    name[i] = 0;
+}
+
+/**
+  * @name   scriptSaveHdr
+  * @brief  write the header and commit the store to FLASH
+  * @param  None
+  * @retval None
+  */
+static void scriptSaveHdr(void)
+{
+    EEPROM_writeBlock(SCRIPT_STORE_ADDR, &scriptHdr, sizeof(scriptHdr));
+    EEPROM_commit();
+}
+
+/**
+  * @name   scriptFind
+  * @brief  find a script record by name
+  * @param  name script name
+  * @param  recLen set to the record length if found
+  * @retval EEPROM address of the record, 0 if not found
+  */
+static uint16_t scriptFind(const char *name, uint8_t *recLen)
+{
+    uint16_t        addr = SCRIPT_RECORDS_ADDR;
+    uint16_t        end = SCRIPT_RECORDS_ADDR + scriptHdr.used;
+    char            recName[SCRIPT_NAME_MAX];
+
+    while ( addr < end )
+    {
+        EEPROM_readBlock(addr, recLen, 1);
+        if ( *recLen == 0 )
+            break;
+
+        scriptReadName(addr, recName);
+        if ( strcmp(recName, name) == 0 )
+            return(addr);
+
+        addr += *recLen;
+    }
+
+    return(0);
+}
+
+/**
+  * @name   scriptLoad
+  * @brief  get a script's bytecode
+  * @param  name script name
+  * @param  code where to copy the bytecode, SCRIPT_CODE_MAX bytes
+  * @retval bytecode length, -1 if there is no such script
+  */
+static int scriptLoad(const char *name, uint8_t *code)
+{
+    uint8_t         recLen;
+    uint16_t        addr = scriptFind(name, &recLen);
+    uint16_t        hdrLen = 1 + strlen(name) + 1;
+
+    if ( addr == 0 )
+        return(-1);
+
+    EEPROM_readBlock(addr + hdrLen, code, recLen - hdrLen);
+    return(recLen - hdrLen);
+}
+
+/**
+  * @name   scriptDelete
+  * @brief  remove a script record, closing up the gap
+  * @param  addr EEPROM address of the record
+  * @param  recLen record length
+  * @retval None
+  * @note   caller saves the header
+  */
+static void scriptDelete(uint16_t addr, uint8_t recLen)
+{
+    uint16_t        end = SCRIPT_RECORDS_ADDR + scriptHdr.used;
+    uint8_t         b;
+
+    for ( uint16_t i = addr + recLen; i < end; i++ )
+    {
+        EEPROM_readBlock(i, &b, 1);
+        EEPROM_writeBlock(i - recLen, &b, 1);
+    }
+
+    scriptHdr.used -= recLen;
+}
+
+/**
+  * @name   scriptFree
+  * @brief  space left in the script store
+  * @param  None
+  * @retval bytes
+  */
+static uint16_t scriptFree(void)
+{
+    return(EEPROM_length() - SCRIPT_RECORDS_ADDR - scriptHdr.used);
+}
+
+/**
+  * @name   script_Init
+  * @brief  validate the script store, erase it if invalid
+  * @param  None
+  * @retval None
+  * @note   bytecode holds command table indexes, so it is dropped if
+  *         the firmware's command registry has changed
+  */
+void script_Init(void)
+{
+    EEPROM_readBlock(SCRIPT_STORE_ADDR, &scriptHdr, sizeof(scriptHdr));
+
+    if ( scriptHdr.sig == SCRIPT_SIGNATURE && scriptHdr.registryId == cliRegistryId() &&
+         scriptHdr.used <= EEPROM_length() - SCRIPT_RECORDS_ADDR )
+    {
+        scriptHdr.autorun[SCRIPT_NAME_MAX - 1] = 0;
+        return;
+    }
+
+    if ( scriptHdr.sig == SCRIPT_SIGNATURE )
+        terminalOut((char *) "Stored scripts were built for other firmware and have been erased");
+
+    memset(&scriptHdr, 0, sizeof(scriptHdr));
+    scriptHdr.sig = SCRIPT_SIGNATURE;
+    scriptHdr.registryId = cliRegistryId();
+    scriptSaveHdr();
+}
+
+/**
+  * @name   script_service
+  * @brief  run the autorun script when a card is inserted
+  * @param  None
+  * @retval None
+  * @note   scheduled task, every SCRIPT_PRESENCE_POLL_MS; a card
+  *         already present at startup counts as an insertion
+  * @note   not while a command or command job runs (the CLI runs
+  *         background tasks then too), so an insertion during one is
+  *         seen when it ends
+  * @note   insertions in binary mode don't autorun, unframed output
+  *         would corrupt the host's frame stream
+  */
+void script_service(void)
+{
+    static bool         wasPresent = false;
+    bool                present;
+    uint8_t             code[SCRIPT_CODE_MAX];
+    int                 len;
+
+    if ( cliJobActive() || cliCommandRunning() )
+        return;
+
+    present = isCardPresent();
+
+    if ( present && !wasPresent && scriptHdr.autorun[0] && !proto_active() )
+    {
+        len = scriptLoad(scriptHdr.autorun, code);
+        if ( len >= 0 )
+        {
+            sprintf(outBfr, "Card inserted, running '%s'", scriptHdr.autorun);
+            terminalOut(outBfr);
+            (void) cliRunCode(code, len);
+            doPrompt();
+        }
+    }
+
+    wasPresent = present;
+}
+
+/**
+  * @name   scriptList
+  * @brief  list stored scripts
+  * @param  None
+  * @retval None
+  */
+static void scriptList(void)
+{
+    uint16_t        addr = SCRIPT_RECORDS_ADDR;
+    uint16_t        end = SCRIPT_RECORDS_ADDR + scriptHdr.used;
+    uint8_t         recLen;
+    char            name[SCRIPT_NAME_MAX];
+    char            *t;
+
+    if ( scriptHdr.used == 0 )
+        terminalOut((char *) "No scripts stored");
+
+    while ( addr < end )
+    {
+        EEPROM_readBlock(addr, &recLen, 1);
+        if ( recLen == 0 )
+            break;
+
+        scriptReadName(addr, name);
+
+        sprintf(outBfr, "  %-16s %3d bytes%s", name, recLen - 2 - (int) strlen(name),
+                (strcmp(name, scriptHdr.autorun) == 0) ? "  (autorun)" : "");
+        terminalOut(outBfr);
+        addr += recLen;
+    }
+
+    t = fmt_str(outBfr, "Free: ");
+    t = fmt_u32(t, scriptFree());
+    fmt_str(t, " bytes");
+    terminalOut(outBfr);
+}
+
+/**
+  * @name   scriptAdd
+  * @brief  append a command to a script, creating it if needed
+  * @param  name script name
+  * @param  argCnt number of 'script' args, command words start at cliArgs[2]
+  * @retval 0=OK 1=error
+  */
+static int scriptAdd(const char *name, int argCnt)
+{
+    char            cmdLine[MAX_LINE_SZ];
+    char            *t = cmdLine;
+    uint8_t         code[SCRIPT_CODE_MAX];
+    uint8_t         recLen;
+    uint8_t         oldLen;
+    uint16_t        addr;
+    int             len;
+    int             n;
+
+    *t = 0;
+    for ( int i = 2; i < argCnt; i++ )
+    {
+        if ( t != cmdLine )
+            t = fmt_str(t, " ");
+        t = fmt_str(t, cliArgs[i].s);
+    }
+
+    len = scriptLoad(name, code);
+    if ( len < 0 )
+        len = 0;
+
+    // compiling reuses tokens[] and cliArgs[], name was copied by the caller
+    n = cliCompile(cmdLine, &code[len], SCRIPT_CODE_MAX - len);
+    if ( n <= 0 )
+    {
+        sprintf(outBfr, "Command not added to '%s'", name);
+        SHOW();
+        return(1);
+    }
+
+    len += n;
+    recLen = 1 + strlen(name) + 1 + len;
+
+    addr = scriptFind(name, &oldLen);
+    if ( addr == 0 )
+        oldLen = 0;
+
+    if ( recLen > scriptFree() + oldLen )
+    {
+        terminalOut((char *) "Script store is full");
+        return(1);
+    }
+
+    if ( addr != 0 )
+        scriptDelete(addr, oldLen);
+
+    // records are appended, an updated script moves to the end
+    addr = SCRIPT_RECORDS_ADDR + scriptHdr.used;
+    EEPROM_writeBlock(addr, &recLen, 1);
+    EEPROM_writeBlock(addr + 1, name, strlen(name) + 1);
+    EEPROM_writeBlock(addr + 1 + strlen(name) + 1, code, len);
+    scriptHdr.used += recLen;
+    scriptSaveHdr();
+
+    sprintf(outBfr, "'%s' is %d bytes", name, len);
+    SHOW();
+    return(0);
+}
+
+/**
+  * @name   scriptCmd
+  * @brief  manage stored scripts
+  * @param  cliArgs[0] list, add, del or auto
+  * @param  cliArgs[1] script name
+  * @param  cliArgs[2..] command to add
+  * @retval 0=OK 1=error
+  * @note   'script add' appends one command per call
+  */
+int scriptCmd(int argCnt)
+{
+    char            name[SCRIPT_NAME_MAX];
+    uint16_t        addr;
+    uint8_t         recLen;
+
+    if ( argCnt == 0 || cliArgs[0].i == SCRIPT_LIST )
+    {
+        scriptList();
+        return(0);
+    }
+
+    if ( argCnt < 2 )
+    {
+        if ( cliArgs[0].i == SCRIPT_AUTO )
+        {
+            sprintf(outBfr, "Autorun on card insertion: %s", scriptHdr.autorun[0] ? scriptHdr.autorun : "off");
+            SHOW();
+            return(0);
+        }
+
+        terminalOut((char *) "Usage: script add <name> <command...> | del <name> | auto <name|off> | list");
+        return(1);
+    }
+
+    if ( strlen(cliArgs[1].s) >= SCRIPT_NAME_MAX )
+    {
+        sprintf(outBfr, "Script name is limited to %d characters", SCRIPT_NAME_MAX - 1);
+        SHOW();
+        return(1);
+    }
+
+    strcpy(name, cliArgs[1].s);
+
+    switch ( cliArgs[0].i )
+    {
+        case SCRIPT_ADD:
+            if ( argCnt < 3 )
+            {
+                terminalOut((char *) "Usage: script add <name> <command...>");
+                return(1);
+            }
+            return(scriptAdd(name, argCnt));
+
+        case SCRIPT_DEL:
+            addr = scriptFind(name, &recLen);
+            if ( addr == 0 )
+                break;
+
+            scriptDelete(addr, recLen);
+            if ( strcmp(name, scriptHdr.autorun) == 0 )
+                scriptHdr.autorun[0] = 0;
+            scriptSaveHdr();
+            return(0);
+
+        case SCRIPT_AUTO:
+        default:
+            if ( strcmp(name, "off") == 0 )
+            {
+                scriptHdr.autorun[0] = 0;
+            }
+            else if ( scriptFind(name, &recLen) != 0 )
+            {
+                strcpy(scriptHdr.autorun, name);
+            }
+            else
+            {
+                break;
+            }
+
+            scriptSaveHdr();
+            return(0);
+    }
+
+    sprintf(outBfr, "No script named '%s'", name);
+    SHOW();
+    return(1);
+}
+
+/**
+  * @name   runCmd
+  * @brief  run a stored script
+  * @param  cliArgs[0] script name
+  * @retval 0=OK 1=error or stopped
+  */
+int runCmd(int argCnt)
+{
+    uint8_t         code[SCRIPT_CODE_MAX];
+    int             len = scriptLoad(cliArgs[0].s, code);
+
+    if ( len < 0 )
+    {
+        sprintf(outBfr, "No script named '%s'", cliArgs[0].s);
+        SHOW();
+        return(1);
+    }
+
+    return(cliRunCode(code, len) ? 0 : 1);
+}
@@ -0,0 +1,539 @@
+//===================================================================
+// terminal.cpp
+// Buffered terminal output.  Producers append to a fixed-size TX
+// ring and return immediately; loop() drains the ring into the USB
+// CDC endpoint one packet at a time via term_service().  Large
+// outputs such as memory dumps can instead be staged and sent as
+// multi-packet bulk transfers with term_bulkWrite().
+//
+// Input is drained from the CDC OUT endpoint into an RX ring a whole
+// packet at a time; term_getLine() assembles it into command lines,
+// handling echo, backspace and escape sequences split across packets.
+//===================================================================
+#include <Arduino.h>
+#include "main.hpp"
+#include "terminal.hpp"
+#include "usbcore.hpp"
+#include "perf.hpp"
+
+#define TERM_TX_RING_MASK         (TERM_TX_RING_SIZE - 1)
+#define TERM_TX_CHUNK             64        // one full speed bulk packet
+#define TERM_RX_RING_MASK         (TERM_RX_RING_SIZE - 1)
+
+// line assembler escape sequence states
+typedef enum {
+    RX_NORMAL = 0,
+    RX_ESC,                 // got ESC
+    RX_CSI,                 // got ESC [ or ESC O, waiting for the final byte
+
+} rx_state_t;
+
+// head and tail are free running; (head - tail) is the fill level
+static uint8_t            txRing[TERM_TX_RING_SIZE];
+static uint16_t           txHead = 0;
+static uint16_t           txTail = 0;
+
+// bulk staging buffer, the USB controller reads it in place so it
+// has to be word aligned
+static uint8_t            bulkBfr[TERM_BULK_SIZE] __attribute__((__aligned__(4)));
+static uint16_t           bulkLen = 0;
+
+// output redirection, see term_setSink()
+static term_sink_t        outSink = NULL;
+
+// total output bytes, see term_outCount()
+static uint32_t           outCount = 0;
+
+// RX ring, same free running head/tail scheme as the TX ring
+static uint8_t            rxRing[TERM_RX_RING_SIZE];
+static uint16_t           rxHead = 0;
+static uint16_t           rxTail = 0;
+
+// line assembler state, kept between calls so a line or escape
+// sequence can arrive in any number of pieces
+static char               rxLine[MAX_LINE_SZ];
+static char               rxLastLine[MAX_LINE_SZ] = "help";
+static uint16_t           rxLineLen = 0;
+static rx_state_t         rxState = RX_NORMAL;
+static bool               rxLastWasCR = false;
+static bool               rxOverflow = false;
+
+/**
+  * @name   term_setSink
+  * @brief  redirect terminal output
+  * @param  sink function to receive output, NULL to restore
+  * @retval None
+  * @note   used to capture command output, e.g. into protocol frames;
+  *         the sink itself sends with term_writeRaw()
+  */
+void term_setSink(term_sink_t sink)
+{
+    outSink = sink;
+}
+
+/**
+  * @name   term_write
+  * @brief  send terminal output
+  * @param  s pointer to bytes to send
+  * @param  len number of bytes
+  * @retval None
+  * @note   goes to the TX ring unless redirected by term_setSink()
+  */
+void term_write(const char *s, uint16_t len)
+{
+    outCount += len;
+
+    if ( outSink != NULL )
+        outSink(s, len);
+    else
+        term_writeRaw(s, len);
+}
+
+/**
+  * @name   term_writeRaw
+  * @brief  append bytes to the TX ring
+  * @param  s pointer to bytes to send
+  * @param  len number of bytes
+  * @retval None
+  * @note   if the ring is full, drains it to make room (backpressure)
+  */
+void term_writeRaw(const char *s, uint16_t len)
+{
+    uint16_t        space;
+    uint16_t        ndx;
+    uint16_t        n;
+
+    while ( len > 0 )
+    {
+        space = TERM_TX_RING_SIZE - (uint16_t) (txHead - txTail);
+        if ( space == 0 )
+        {
+            term_service();
+            continue;
+        }
+
+        // copy up to the end of the ring storage, wrap on the next pass
+        ndx = txHead & TERM_TX_RING_MASK;
+        n = TERM_TX_RING_SIZE - ndx;
+        if ( n > space )
+            n = space;
+        if ( n > len )
+            n = len;
+
+        memcpy(&txRing[ndx], s, n);
+        txHead += n;
+        s += n;
+        len -= n;
+    }
+}
+
+/**
+  * @name   term_puts
+  * @brief  append a string to the TX ring
+  * @param  s string to send
+  * @retval None
+  */
+void term_puts(const char *s)
+{
+    term_write(s, strlen(s));
+}
+
+/**
+  * @name   term_putc
+  * @brief  append a single character to the TX ring
+  * @param  c character to send
+  * @retval None
+  */
+void term_putc(char c)
+{
+    term_write(&c, 1);
+}
+
+/**
+  * @name   term_service
+  * @brief  send the next packet's worth of the TX ring
+  * @param  None
+  * @retval None
+  * @note   called from loop(); data is discarded if no host is
+  *         connected or the endpoint times out so producers can't hang
+  */
+void term_service(void)
+{
+    uint16_t        count = txHead - txTail;
+    uint16_t        ndx = txTail & TERM_TX_RING_MASK;
+    uint16_t        n;
+    size_t          written;
+    uint32_t        start;
+
+    if ( count == 0 )
+        return;
+
+    if ( !SerialUSB )
+    {
+        txTail = txHead;
+        return;
+    }
+
+    n = TERM_TX_RING_SIZE - ndx;
+    if ( n > count )
+        n = count;
+    if ( n > TERM_TX_CHUNK )
+        n = TERM_TX_CHUNK;
+
+    start = micros();
+    written = SerialUSB.write(&txRing[ndx], n);
+    perf_probe(PERF_USB_SEND, start);
+    if ( written == 0 || written > n )
+        written = n;
+
+    txTail += written;
+}
+
+/**
+  * @name   term_flush
+  * @brief  drain the TX ring completely
+  * @param  None
+  * @retval None
+  * @note   use before blocking waits so output isn't held back
+  */
+void term_flush(void)
+{
+    while ( txHead != txTail )
+    {
+        term_service();
+    }
+
+    SerialUSB.flush();
+}
+
+/**
+  * @name   term_bulkWrite
+  * @brief  append bytes to the bulk staging buffer
+  * @param  s pointer to bytes to send
+  * @param  len number of bytes
+  * @retval None
+  * @note   the buffer is sent as one transfer each time it fills;
+  *         call term_bulkFlush() when done
+  */
+void term_bulkWrite(const char *s, uint16_t len)
+{
+    uint16_t        n;
+
+    outCount += len;
+
+    while ( len > 0 )
+    {
+        if ( bulkLen == TERM_BULK_SIZE )
+            term_bulkFlush();
+
+        n = TERM_BULK_SIZE - bulkLen;
+        if ( n > len )
+            n = len;
+
+        memcpy(&bulkBfr[bulkLen], s, n);
+        bulkLen += n;
+        s += n;
+        len -= n;
+    }
+}
+
+/**
+  * @name   term_bulkReserve
+  * @brief  get space in the bulk staging buffer to format into
+  * @param  n number of bytes needed, at most TERM_BULK_SIZE
+  * @retval pointer to n free bytes
+  * @note   sends the buffer first if it can't hold n more bytes;
+  *         follow with term_bulkCommit() for the bytes used
+  */
+char *term_bulkReserve(uint16_t n)
+{
+    if ( bulkLen + n > TERM_BULK_SIZE )
+        term_bulkFlush();
+
+    return((char *) &bulkBfr[bulkLen]);
+}
+
+/**
+  * @name   term_bulkCommit
+  * @brief  add bytes formatted in place to the bulk staging buffer
+  * @param  n number of bytes used from term_bulkReserve()
+  * @retval None
+  */
+void term_bulkCommit(uint16_t n)
+{
+    bulkLen += n;
+    outCount += n;
+}
+
+/**
+  * @name   term_outCount
+  * @brief  running total of output bytes
+  * @param  None
+  * @retval bytes written with term_write() or to the bulk buffer
+  * @note   free running, callers take differences
+  */
+uint32_t term_outCount(void)
+{
+    return(outCount);
+}
+
+/**
+  * @name   term_bulkFlush
+  * @brief  send the bulk staging buffer
+  * @param  None
+  * @retval None
+  * @note   drains the TX ring first so output stays in order
+  */
+void term_bulkFlush(void)
+{
+    uint32_t        start;
+
+    if ( bulkLen == 0 )
+        return;
+
+    if ( outSink != NULL )
+    {
+        outSink((const char *) bulkBfr, bulkLen);
+    }
+    else
+    {
+        term_flush();
+
+        if ( SerialUSB )
+        {
+            start = micros();
+            (void) usb_sendBulk(bulkBfr, bulkLen);
+            perf_probe(PERF_USB_SEND, start);
+        }
+    }
+
+    bulkLen = 0;
+}
+
+/**
+  * @name   term_rxPoll
+  * @brief  move everything the host has sent into the RX ring
+  * @param  None
+  * @retval None
+  * @note   bytes are left in the endpoint if the ring is full, so the
+  *         host is NAKed instead of input being dropped
+  */
+void term_rxPoll(void)
+{
+    uint16_t        space;
+    uint16_t        ndx;
+    uint16_t        n;
+    int             avail;
+
+    while ( (avail = SerialUSB.available()) > 0 )
+    {
+        space = TERM_RX_RING_SIZE - (uint16_t) (rxHead - rxTail);
+        if ( space == 0 )
+            return;
+
+        ndx = rxHead & TERM_RX_RING_MASK;
+        n = TERM_RX_RING_SIZE - ndx;
+        if ( n > space )
+            n = space;
+        if ( n > avail )
+            n = avail;
+
+        n = SerialUSB.readBytes((char *) &rxRing[ndx], n);
+        if ( n == 0 )
+            return;
+
+        rxHead += n;
+    }
+}
+
+/**
+  * @name   term_getc
+  * @brief  get the next received byte
+  * @param  None
+  * @retval byte received or -1 if none
+  */
+int term_getc(void)
+{
+    if ( rxHead == rxTail )
+        term_rxPoll();
+
+    if ( rxHead == rxTail )
+        return(-1);
+
+    return(rxRing[rxTail++ & TERM_RX_RING_MASK]);
+}
+
+/**
+  * @name   term_peek
+  * @brief  look at the next received byte without removing it
+  * @param  None
+  * @retval byte received or -1 if none
+  */
+int term_peek(void)
+{
+    if ( rxHead == rxTail )
+        term_rxPoll();
+
+    if ( rxHead == rxTail )
+        return(-1);
+
+    return(rxRing[rxTail & TERM_RX_RING_MASK]);
+}
+
+/**
+  * @name   term_break
+  * @brief  check for Ctrl-C to stop a long running command
+  * @param  None
+  * @retval true if Ctrl-C was received (it is removed), else false
+  * @note   always false while output is redirected, since input is
+  *         then frames from a host rather than keystrokes
+  */
+bool term_break(void)
+{
+    if ( outSink != NULL || term_peek() != 0x03 )
+        return(false);
+
+    (void) term_getc();
+    return(true);
+}
+
+/**
+  * @name   term_rxFlush
+  * @brief  discard all pending input
+  * @param  None
+  * @retval None
+  */
+void term_rxFlush(void)
+{
+    do
+    {
+        rxTail = rxHead;
+        term_rxPoll();
+    } while ( rxHead != rxTail );
+}
+
+/**
+  * @name   term_lineFlush
+  * @brief  discard a partly assembled command line
+  * @param  None
+  * @retval None
+  */
+void term_lineFlush(void)
+{
+    rxLineLen = 0;
+    rxState = RX_NORMAL;
+    rxLastWasCR = false;
+    rxOverflow = false;
+}
+
+/**
+  * @name   term_getLine
+  * @brief  assemble received bytes into a command line
+  * @param  line where to copy a completed line, without CR/LF
+  * @param  size size of line
+  * @retval true if a line is complete, else false
+  * @note   echoes input; CR, LF or CR LF ends a line; backspace and
+  *         delete erase; up arrow recalls the last line; other escape
+  *         sequences are consumed and ignored; returns after one line
+  *         so the caller runs it before later input is processed
+  */
+bool term_getLine(char *line, uint16_t size)
+{
+    const char      bs[4] = {0x1b, '[', '1', 'D'};  // terminal: backspace seq
+    int             byteIn;
+    bool            wasCR;
+
+    while ( (byteIn = term_getc()) >= 0 )
+    {
+        wasCR = rxLastWasCR;
+        rxLastWasCR = false;
+
+        if ( rxState == RX_ESC )
+        {
+            // ESC [ is CSI, ESC O is SS3 (cursor keys in application mode)
+            rxState = (byteIn == '[' || byteIn == 'O') ? RX_CSI : RX_NORMAL;
+            continue;
+        }
+
+        if ( rxState == RX_CSI )
+        {
+            // parameter and intermediate bytes until the final byte
+            if ( byteIn >= 0x20 && byteIn <= 0x3f )
+                continue;
+
+            rxState = RX_NORMAL;
+            if ( byteIn == 'A' )
+            {
+                // up arrow: echo last command entered then hand it back
+                terminalOut(rxLastLine);
+                strncpy(line, rxLastLine, size - 1);
+                line[size - 1] = 0;
+                rxLineLen = 0;
+                return(true);
+            }
+            continue;
+        }
+
+        if ( byteIn == 0x0d || byteIn == 0x0a )
+        {
+            // LF right after CR is the rest of a CR LF line ending
+            if ( byteIn == 0x0a && wasCR )
+                continue;
+
+            rxLastWasCR = (byteIn == 0x0d);
+            terminalOut((char *) " ");
+
+            if ( rxOverflow )
+            {
+                // hand back an empty line so the prompt is redisplayed
+                rxOverflow = false;
+                rxLineLen = 0;
+                line[0] = 0;
+                return(true);
+            }
+
+            rxLine[rxLineLen] = 0;
+            rxLineLen = 0;
+            if ( rxLine[0] )
+                strcpy(rxLastLine, rxLine);
+
+            strncpy(line, rxLine, size - 1);
+            line[size - 1] = 0;
+            return(true);
+        }
+        else if ( byteIn == 0x1b )
+        {
+            rxState = RX_ESC;
+        }
+        else if ( byteIn == 127 || byteIn == 8 )
+        {
+            // delete & backspace do the same thing which is erase last char entered
+            // and backspace once
+            if ( rxLineLen )
+            {
+                rxLine[--rxLineLen] = 0;
+                term_write(bs, 4);
+                term_putc(' ');
+                term_write(bs, 4);
+            }
+        }
+        else if ( rxOverflow == false )
+        {
+            // all other keys get echoed & stored in buffer
+            term_putc((char) byteIn);
+            if ( rxLineLen < (MAX_LINE_SZ - 1) )
+            {
+                rxLine[rxLineLen++] = byteIn;
+            }
+            else
+            {
+                // drop the rest of the line rather than run a fragment of it
+                terminalOut((char *) " ");
+                terminalOut((char *) "Serial input buffer overflow!");
+                rxOverflow = true;
+            }
+        }
+    }
+
+    return(false);
+}
@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include "main.hpp"
+#include "commands.hpp"
+#include "perf.hpp"
 
 uint32_t                sampleRate = 4096;              // Mhz = this % 2
 
@@ -19,18 +21,18 @@ static uint8_t          scanClockState = 1;
   */
 void timers_scanChainCapture(void)
 {
+    uint32_t        start = micros();
+
     // initialize vars used by timer handler
     scanClockPulseCounter = 0;
     scanShiftRegister_0 = 0;
     shift = 31;
 
-    // SCAN_CLK high
-    digitalWrite(OCP_SCAN_CLK, scanClockState);
-
-    // SCAN_LD_N low briefly
-    digitalWrite(OCP_SCAN_LD_N, 0);
+    // SCAN_CLK high and SCAN_LD_N low together, then SCAN_LD_N
+    // back high after a while
+    writePinMask(pinGroupBits(PIN_GROUP_SCAN), scanClockState ? pinBit(OCP_SCAN_CLK) : 0);
     delayMicroseconds(200);
-    digitalWrite(OCP_SCAN_LD_N, 1);
+    writePinMask(pinBit(OCP_SCAN_LD_N), pinBit(OCP_SCAN_LD_N));
 
     // start capture (when CLK falls)
     enableScanClk = true;
@@ -42,6 +44,7 @@ void timers_scanChainCapture(void)
     }
 
     enableScanClk = false;
+    perf_probe(PERF_SCAN_CAPTURE, start);
 }
 
 /**